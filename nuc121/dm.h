@@ -4,6 +4,23 @@
 #include <stdint.h>
 #include "dm_bsp.h"
 
-void dap_handler(uint8_t *RxDataBuffer);
+/* the first of the ID_DAP_Vendor commands (0x80 to 0x9F) that dap_handler() leaves to vendor_extension() */
+#if defined(DAP_SUPPORT_MEMORY_ACCESS)
+#define DAP_VENDOR_EXTENSION_FIRST  0x88
+#elif defined(DAP_SUPPORT_ATTACH)
+#define DAP_VENDOR_EXTENSION_FIRST  0x84
+#else
+#define DAP_VENDOR_EXTENSION_FIRST  0x80
+#endif
+
+uint16_t dap_handler(const uint8_t *request, uint16_t request_length, uint8_t *response, uint16_t response_size);
+uint32_t dap_request_length(const uint8_t *request, uint16_t length);
+
+/* the size of the report written by dap_event_poll(); see dm.c */
+#define DAP_EVENT_REPORT_SIZE  6
+
+#ifdef DAP_SUPPORT_EVENTS
+uint8_t dap_event_poll(uint8_t *report);
+#endif
 
 #endif /* __DM_H */
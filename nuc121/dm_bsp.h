@@ -1,9 +1,23 @@
 #ifndef __DM_BSP_H
 #define __DM_BSP_H
 
-#define DAP_PACKET_COUNT  1
+#define DAP_PACKET_COUNT  4
 #define DAP_PACKET_SIZE   64
 
 #define DAP_SUPPORT_JTAG_SEQUENCE
+#define DAP_SUPPORT_ATTACH /* vendor attach command; see swd_attach() in dm.c */
+
+#define DAP_USE_WORD_SHIFT /* 32-bit target; see dm.c */
+
+#define DAP_SUPPORT_MEMORY_ACCESS /* vendor memory commands; see memory_block() in dm.c */
+
+/* uncomment to shift SWD with SPI0 rather than bit-banging; this needs the SPI0 wiring given in swdio_bsp.h */
+//#define DAP_USE_SPI_ENGINE
+
+/* uncomment to stream large DAP_TransferBlock writes with overrun detection; see posted_write_block() in dm.c */
+//#define DAP_USE_POSTED_WRITES
+
+/* uncomment to skip writes that would leave SELECT, CSW or TAR as they already are; see shadow_update() in dm.c */
+//#define DAP_USE_REGISTER_SHADOW
 
 #endif /* __DM_BSP_H */
@@ -120,9 +120,9 @@ int main(void)
   usb_hw_init();
   usb_vendorhid_init();
 
+  /* USB events are handled by USBD_IRQHandler(); the main loop only has to execute the queued DAP commands */
   while (1)
   {
-    usb_task();
     usb_vendorhid_task();
   }
 
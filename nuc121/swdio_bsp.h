@@ -2,33 +2,90 @@
 #define __SWDIO_BSP_H
 
 #include <NUC121.h>
+#include "dm_bsp.h" /* for DAP_USE_SPI_ENGINE */
 
 /*
 this must be customized to suit the end application
 */
 
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+SPI0 (MFP 1) shifts the SWD request and data phases; see swdio_spi.c
+SWCLK is on SPI0_CLK (PC.1) and SWDIO on SPI0_MOSI (PC.3), with SPI0_MISO (PC.2) also wired to SWDIO;
+the macros below bit-bang these same pins for everything else
+*/
+
+#define SWD_GPIO     PC
+#define SWD_PORT     2
+#define CLK_PIN      1
+#define DATA_PIN     3
+#define MISO_PIN     2
+
+#define SWD_MFP      SYS->GPC_MFPL
+#define SWD_MFP_SPI  0x1UL
+
+#else
+
+#define SWD_GPIO     PB
+#define SWD_PORT     1
+#define CLK_PIN      14
+#define DATA_PIN     13
+
+#endif
+
+#define RESET_GPIO   PB
+#define RESET_PORT   1
+#define RESET_PIN    12
+
 #define MODE_INPUT  0UL
 #define MODE_OUTPUT 1UL
 
-#define CLK_LOW      { PB->DOUT &= ~GPIO_DOUT_DOUT14_Msk; }
-#define CLK_HIGH     { PB->DOUT |=  GPIO_DOUT_DOUT14_Msk; }
-#define CLK_ENABLE   { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE14_Msk) | (MODE_OUTPUT << GPIO_MODE_MODE14_Pos); }
-#define CLK_HIZ      { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE14_Msk) | (MODE_INPUT  << GPIO_MODE_MODE14_Pos); }
+/*
+each pin also has its own Pxn_PDIO register, so outputs are written without a read-modify-write of Px_DOUT
+*/
+
+#define PDIO(port, pin) ( *((volatile uint32_t *)(GPIO_PIN_DATA_BASE + ((((port) << 4) + (pin)) << 2))) )
+
+#define PIN_MODE(gpio, pin, mode) { (gpio)->MODE = ((gpio)->MODE & ~(0x3UL << ((pin) * 2))) | ((mode) << ((pin) * 2)); }
+
+#define CLK_LOW      { PDIO(SWD_PORT, CLK_PIN) = 0; }
+#define CLK_HIGH     { PDIO(SWD_PORT, CLK_PIN) = 1; }
+#define CLK_ENABLE   PIN_MODE(SWD_GPIO, CLK_PIN, MODE_OUTPUT)
+#define CLK_HIZ      PIN_MODE(SWD_GPIO, CLK_PIN, MODE_INPUT)
 
-#define DATA_LOW     { PB->DOUT &= ~GPIO_DOUT_DOUT13_Msk; }
-#define DATA_HIGH    { PB->DOUT |=  GPIO_DOUT_DOUT13_Msk; }
-#define DATA_ENABLE  { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE13_Msk) | (MODE_OUTPUT << GPIO_MODE_MODE13_Pos); }
-#define DATA_HIZ     { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE13_Msk) | (MODE_INPUT  << GPIO_MODE_MODE13_Pos); }
+#define DATA_LOW     { PDIO(SWD_PORT, DATA_PIN) = 0; }
+#define DATA_HIGH    { PDIO(SWD_PORT, DATA_PIN) = 1; }
+#define DATA_ENABLE  PIN_MODE(SWD_GPIO, DATA_PIN, MODE_OUTPUT)
+#define DATA_HIZ     PIN_MODE(SWD_GPIO, DATA_PIN, MODE_INPUT)
 
-#define RESET_LOW    { PB->DOUT &= ~GPIO_DOUT_DOUT12_Msk; }
-#define RESET_HIGH   { PB->DOUT |=  GPIO_DOUT_DOUT12_Msk; }
-#define RESET_ENABLE { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE12_Msk) | (MODE_OUTPUT << GPIO_MODE_MODE12_Pos); }
-#define RESET_HIZ    { PB->MODE = (PB->MODE & ~GPIO_MODE_MODE12_Msk) | (MODE_INPUT  << GPIO_MODE_MODE12_Pos); }
+#define RESET_LOW    { PDIO(RESET_PORT, RESET_PIN) = 0; }
+#define RESET_HIGH   { PDIO(RESET_PORT, RESET_PIN) = 1; }
+#define RESET_ENABLE PIN_MODE(RESET_GPIO, RESET_PIN, MODE_OUTPUT)
+#define RESET_HIZ    PIN_MODE(RESET_GPIO, RESET_PIN, MODE_INPUT)
 
+#ifdef DAP_USE_SPI_ENGINE
+#define SWDIO_INIT  { swd_spi_init(); }
+#else
 #define SWDIO_INIT  { }
+#endif
+
+#define DATA_READ   ( PDIO(SWD_PORT, DATA_PIN) )
+#define CLK_READ    ( PDIO(SWD_PORT, CLK_PIN) )
+#define RESET_READ  ( PDIO(RESET_PORT, RESET_PIN) )
+
+/* SysTick, otherwise unused, counts down from the 48MHz core clock and times the vendor wait command */
+
+#define TIMER_INIT         { SysTick->LOAD = 0xFFFFFFUL; SysTick->VAL = 0; SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk; }
+#define TIMER_READ         (~SysTick->VAL)
+#define TIMER_MASK         0xFFFFFFUL
+#define TIMER_TICKS_PER_US 48
+
+#ifdef DAP_USE_SPI_ENGINE
+#include <stdint.h>
 
-#define DATA_READ   ( PB->PIN & GPIO_PIN_PIN13_Msk )
-#define CLK_READ    ( PB->PIN & GPIO_PIN_PIN14_Msk )
-#define RESET_READ  ( PB->PIN & GPIO_PIN_PIN12_Msk )
+void swd_spi_init(void);
+uint8_t swd_transaction(uint8_t request, uint32_t *data);
+#endif
 
 #endif /* __SWDIO_BSP_H */
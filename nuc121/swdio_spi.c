@@ -0,0 +1,196 @@
+/*
+    CMSIS-DAP implementation for NUC121/NUC125
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <stdint.h>
+#include "swdio_bsp.h"
+#include "clk.h"
+
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+SPI0 takes over from bit-banging for the parts of a SWD transaction that are a whole number of bits
+suited to a SPI transaction: the 8-bit request and the 32-bit data phase (as a single 32-bit transaction);
+the turnaround, ACK and parity cycles in between are still bit-banged on the same pins, and dm.c adds any
+idle cycles
+
+SPI0_CLK and SPI0_MOSI are only given to SPI0 (via the MFP register) for the duration of each burst;
+otherwise they are GPIO, so that dm.c can continue to bit-bang DAP_SWJ_Sequence etc. as before
+
+SWCLK idles low throughout (CLKPOL=0), same as the bit-banged code.  Host data changes on the falling edge
+(TXNEG=1), ready for the target to sample it on the rising edge.  Target data changes after each rising edge,
+so it is sampled on the falling edge instead (RXNEG=1).  As SPI then clocks a rising edge before sampling,
+the last ACK bit is read without the rising edge that normally follows it; the read data phase supplies it.
+*/
+
+#ifndef SWD_SPI_DIVIDER
+#define SWD_SPI_DIVIDER  7 /* HIRC / (DIVIDER + 1): 6MHz SWCLK */
+#endif
+
+#define SWD_SPI_CTL      (SPI_CTL_LSB_Msk)
+#define EDGE_WRITE       (SPI_CTL_TXNEG_Msk)
+#define EDGE_READ        (SPI_CTL_RXNEG_Msk)
+
+#define PIN_MFP(pin, mfp) { SWD_MFP = (SWD_MFP & ~(0xFUL << ((pin) * 4))) | ((mfp) << ((pin) * 4)); }
+#define MFP_GPIO          0x0UL
+
+static inline uint32_t spi_parity(uint32_t value)
+{
+  value ^= value >> 16;
+  value ^= value >> 8;
+  value ^= value >> 4;
+  return (0x6996 >> (value & 0x0F)) & 0x01;
+}
+
+/* hand SPI0_CLK (and optionally SPI0_MOSI) to SPI0; the CTL register may only be changed whilst SPI0 is disabled */
+
+static void spi_begin(uint32_t edge, uint32_t bits, int drive_data)
+{
+  SPI0->CTL = SWD_SPI_CTL | edge | ((bits & 0x1F) << SPI_CTL_DWIDTH_Pos);
+  SPI0->CTL |= SPI_CTL_SPIEN_Msk;
+  while (!(SPI0->STATUS & SPI_STATUS_SPIENSTS_Msk))
+    ;
+
+  PIN_MFP(CLK_PIN, SWD_MFP_SPI);
+  if (drive_data)
+    PIN_MFP(DATA_PIN, SWD_MFP_SPI);
+}
+
+static uint32_t spi_frame(uint32_t data)
+{
+  SPI0->TX = data;
+  while (SPI0->STATUS & SPI_STATUS_RXEMPTY_Msk);
+  return SPI0->RX;
+}
+
+/*
+wait for SPI0 to finish, then return SPI0_CLK (left low, same as SPI idle) and SPI0_MOSI to GPIO;
+SPI0_MOSI takes on whatever DATA_xxx state the caller has already set up
+*/
+
+static void spi_end(void)
+{
+  while (SPI0->STATUS & SPI_STATUS_BUSY_Msk)
+    ;
+
+  CLK_LOW;
+  CLK_ENABLE;
+  PIN_MFP(CLK_PIN, MFP_GPIO);
+  PIN_MFP(DATA_PIN, MFP_GPIO);
+
+  SPI0->CTL = SWD_SPI_CTL;
+  while (SPI0->STATUS & SPI_STATUS_SPIENSTS_Msk);
+}
+
+static void clock_cycle(void)
+{
+  CLK_HIGH;
+  CLK_LOW;
+}
+
+void swd_spi_init(void)
+{
+  CLK_SetModuleClock(SPI0_MODULE, CLK_CLKSEL2_SPI0SEL_HIRC, MODULE_NoMsk);
+  CLK_EnableModuleClock(SPI0_MODULE);
+
+  SPI0->CTL = SWD_SPI_CTL;
+  while (SPI0->STATUS & SPI_STATUS_SPIENSTS_Msk);
+
+  SPI0->CLKDIV = SWD_SPI_DIVIDER;
+  SPI0->SSCTL = 0;
+  SPI0->FIFOCTL = SPI_FIFOCTL_RXRST_Msk | SPI_FIFOCTL_TXRST_Msk;
+
+  /* SPI0_MISO is only ever an input, so it can stay with SPI0 permanently */
+  PIN_MODE(SWD_GPIO, MISO_PIN, MODE_INPUT);
+  PIN_MFP(MISO_PIN, SWD_MFP_SPI);
+}
+
+uint8_t swd_transaction(uint8_t request, uint32_t *data)
+{
+  uint32_t ack, value;
+
+  /* request; SWDIO is released as it comes back from SPI0, for the turnaround */
+  spi_begin(EDGE_WRITE, 8, 1);
+  spi_frame(request);
+  DATA_HIZ;
+  spi_end();
+
+  /* turnaround, then ACK; the final rising edge is deferred (see above) */
+  ack = 0;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x01;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x02;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x04;
+
+  if ( (1 /* OK */ == ack) && (request & 0x04) )
+  {
+    /* read: the first SPI rising edge is the one deferred above */
+    spi_begin(EDGE_READ, 32, 0);
+    value = spi_frame(0xFFFFFFFF);
+    spi_end();
+    *data = value;
+
+    /* parity bit, then turnaround */
+    CLK_HIGH;
+    CLK_LOW;
+    asm("nop");
+    if ( (DATA_READ ? 1 : 0) != spi_parity(value) )
+      ack |= 0x08;
+    clock_cycle();
+    clock_cycle();
+
+    DATA_LOW;
+    DATA_ENABLE;
+  }
+  else
+  {
+    clock_cycle(); /* rising edge deferred from the ACK */
+
+    if (2 /* WAIT */ == ack)
+      clock_cycle(); /* turnaround cycle (Figure 2-4 DDI 0316D) */
+
+    if (1 /* OK */ != ack)
+      return ack;
+
+    /* write: turnaround cycle, data, then parity bit */
+    clock_cycle();
+    value = *data;
+    DATA_LOW;
+    DATA_ENABLE;
+    spi_begin(EDGE_WRITE, 32, 1);
+    spi_frame(value);
+    spi_end();
+    if (spi_parity(value))
+    {
+      DATA_HIGH;
+    }
+    clock_cycle();
+  }
+
+  /* SWDIO is now the GPIO output that shift_bits_out() expects */
+  return ack;
+}
+
+#endif /* DAP_USE_SPI_ENGINE */
@@ -165,7 +165,7 @@ void usb_hw_init(void)
   USBD->INTSTS = USBD_INTEN_BUSIEN_Msk | USBD_INTEN_USBIEN_Msk | USBD_INTEN_VBDETIEN_Msk | USBD_INTEN_WKEN_Msk | USBD_INTEN_SOFIEN_Msk;
   USBD->INTEN  = USBD_INTEN_BUSIEN_Msk | USBD_INTEN_USBIEN_Msk | USBD_INTEN_VBDETIEN_Msk | USBD_INTEN_WKEN_Msk | USBD_INTEN_SOFIEN_Msk;
 
-//  NVIC_EnableIRQ(USBD_IRQn);
+  NVIC_EnableIRQ(USBD_IRQn);
 }
 
 //-----------------------------------------------------------------------------
@@ -369,7 +369,12 @@ static void periph_ep1_callback(uint8_t *data, int size)
 }
 
 //-----------------------------------------------------------------------------
-void usb_task(void)
+/*
+  all USB events are serviced here, so that packets are acknowledged and bus events handled
+  even whilst the main loop is busy clocking SWD; consequently, every callback (endpoint,
+  SOF, and usb_configuration_callback) is invoked in interrupt context
+*/
+void USBD_IRQHandler(void)
 {
   uint32_t status = USBD->INTSTS;
 #ifdef SUPPORT_LPM
@@ -63,7 +63,7 @@ const usb_device_descriptor_t usb_device_descriptor =
 {
   .bLength            = sizeof(usb_device_descriptor_t),
   .bDescriptorType    = USB_DEVICE_DESCRIPTOR,
-  .bcdUSB             = 0x0200,
+  .bcdUSB             = 0x0210, // 2.1 so that the host asks for the BOS descriptor
   .bDeviceClass       = 0x00,
   .bDeviceSubClass    = 0x00,
   .bDeviceProtocol    = 0x00,
@@ -84,7 +84,7 @@ const usb_configuration_hierarchy_t usb_configuration_hierarchy =
     .bLength             = sizeof(usb_configuration_descriptor_t),
     .bDescriptorType     = USB_CONFIGURATION_DESCRIPTOR,
     .wTotalLength        = sizeof(usb_configuration_hierarchy_t),
-    .bNumInterfaces      = 1,
+    .bNumInterfaces      = 2,
     .bConfigurationValue = 1,
     .iConfiguration      = USB_STR_ZERO,
     .bmAttributes        = 0x80,
@@ -134,6 +134,96 @@ const usb_configuration_hierarchy_t usb_configuration_hierarchy =
     .wMaxPacketSize      = 64,
     .bInterval           = 1,
   },
+
+  // CMSIS-DAP v2: a vendor-specific interface whose name contains "CMSIS-DAP"
+  .bulk_interface =
+  {
+    .bLength             = sizeof(usb_interface_descriptor_t),
+    .bDescriptorType     = USB_INTERFACE_DESCRIPTOR,
+    .bInterfaceNumber    = 1,
+    .bAlternateSetting   = 0,
+    .bNumEndpoints       = 2,
+    .bInterfaceClass     = 0xFF,
+    .bInterfaceSubClass  = 0x00,
+    .bInterfaceProtocol  = 0x00,
+    .iInterface          = USB_STR_PRODUCT,
+  },
+
+  .bulk_ep_out =
+  {
+    .bLength             = sizeof(usb_endpoint_descriptor_t),
+    .bDescriptorType     = USB_ENDPOINT_DESCRIPTOR,
+    .bEndpointAddress    = USB_OUT_ENDPOINT | USB_DAPBULK_OUT,
+    .bmAttributes        = USB_BULK_ENDPOINT,
+    .wMaxPacketSize      = 64,
+    .bInterval           = 0,
+  },
+
+  .bulk_ep_in =
+  {
+    .bLength             = sizeof(usb_endpoint_descriptor_t),
+    .bDescriptorType     = USB_ENDPOINT_DESCRIPTOR,
+    .bEndpointAddress    = USB_IN_ENDPOINT | USB_DAPBULK_IN,
+    .bmAttributes        = USB_BULK_ENDPOINT,
+    .wMaxPacketSize      = 64,
+    .bInterval           = 0,
+  },
+};
+
+const uint8_t usb_bos_descriptor[33] =
+{
+  0x05,                                           // bLength
+  0x0F,                                           // bDescriptorType: BOS
+  0x21, 0x00,                                     // wTotalLength
+  0x01,                                           // bNumDeviceCaps
+  0x1C,                                           // bLength
+  0x10,                                           // bDescriptorType: device capability
+  0x05,                                           // bDevCapabilityType: platform
+  0x00,                                           // bReserved
+  0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C, // PlatformCapabilityUUID: D8DD60DF-4589-4CC7-9CD2-659D9E648A9F
+  0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F,
+  0x00, 0x00, 0x03, 0x06,                         // dwWindowsVersion: Windows 8.1
+  0xB2, 0x00,                                     // wMSOSDescriptorSetTotalLength
+  USB_MS_OS_20_VENDOR_CODE,                       // bMS_VendorCode
+  0x00,                                           // bAltEnumCode
+};
+
+// binds WinUSB to the CMSIS-DAP v2 interface, so that no .inf file is needed on Windows
+static const uint8_t usb_ms_os_20_descriptor_set[178] =
+{
+  0x0A, 0x00,                                     // wLength
+  0x00, 0x00,                                     // wDescriptorType: MS OS 2.0 descriptor set header
+  0x00, 0x00, 0x03, 0x06,                         // dwWindowsVersion: Windows 8.1
+  0xB2, 0x00,                                     // wTotalLength
+  0x08, 0x00,                                     // wLength
+  0x01, 0x00,                                     // wDescriptorType: configuration subset header
+  0x00,                                           // bConfigurationValue
+  0x00,                                           // bReserved
+  0xA8, 0x00,                                     // wTotalLength
+  0x08, 0x00,                                     // wLength
+  0x02, 0x00,                                     // wDescriptorType: function subset header
+  0x01,                                           // bFirstInterface
+  0x00,                                           // bReserved
+  0xA0, 0x00,                                     // wSubsetLength
+  0x14, 0x00,                                     // wLength
+  0x03, 0x00,                                     // wDescriptorType: compatible ID
+  'W', 'I', 'N', 'U', 'S', 'B', 0x00, 0x00,       // CompatibleID
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // SubCompatibleID
+  0x84, 0x00,                                     // wLength
+  0x04, 0x00,                                     // wDescriptorType: registry property
+  0x07, 0x00,                                     // wPropertyDataType: REG_MULTI_SZ
+  0x2A, 0x00,                                     // wPropertyNameLength
+  // PropertyName: "DeviceInterfaceGUIDs"
+  'D', 0x00, 'e', 0x00, 'v', 0x00, 'i', 0x00, 'c', 0x00, 'e', 0x00, 'I', 0x00, 'n', 0x00,
+  't', 0x00, 'e', 0x00, 'r', 0x00, 'f', 0x00, 'a', 0x00, 'c', 0x00, 'e', 0x00, 'G', 0x00,
+  'U', 0x00, 'I', 0x00, 'D', 0x00, 's', 0x00, 0x00, 0x00,
+  0x50, 0x00,                                     // wPropertyDataLength
+  // PropertyData: "{CDB3B5AD-293B-4663-AA36-1AAE46463776}" (the CMSIS-DAP v2 interface GUID)
+  '{', 0x00, 'C', 0x00, 'D', 0x00, 'B', 0x00, '3', 0x00, 'B', 0x00, '5', 0x00, 'A', 0x00,
+  'D', 0x00, '-', 0x00, '2', 0x00, '9', 0x00, '3', 0x00, 'B', 0x00, '-', 0x00, '4', 0x00,
+  '6', 0x00, '6', 0x00, '3', 0x00, '-', 0x00, 'A', 0x00, 'A', 0x00, '3', 0x00, '6', 0x00,
+  '-', 0x00, '1', 0x00, 'A', 0x00, 'A', 0x00, 'E', 0x00, '4', 0x00, '6', 0x00, '4', 0x00,
+  '6', 0x00, '3', 0x00, '7', 0x00, '7', 0x00, '6', 0x00, '}', 0x00, 0x00, 0x00, 0x00, 0x00,
 };
 
 const usb_string_descriptor_zero_t usb_string_descriptor_zero =
@@ -151,7 +241,7 @@ const char *const usb_strings[] =
   [USB_STR_SERIAL_NUMBER] = usb_serial_number,
 };
 
-/* moved here to have access to "usb_hid_report_descriptor" */
+/* moved here to have access to "usb_hid_report_descriptor" and "usb_ms_os_20_descriptor_set" */
 bool usb_class_handle_request(usb_request_t *request)
 {
   int length = request->wLength;
@@ -165,6 +255,16 @@ bool usb_class_handle_request(usb_request_t *request)
       usb_control_send((uint8_t *)usb_hid_report_descriptor, length);
     } break;
 
+    case USB_CMD(IN, DEVICE, VENDOR, MS_OS_20_VENDOR_CODE):
+    {
+      if (USB_MS_OS_20_DESCRIPTOR_INDEX != request->wIndex)
+        return false;
+
+      length = LIMIT(length, sizeof(usb_ms_os_20_descriptor_set));
+
+      usb_control_send((uint8_t *)usb_ms_os_20_descriptor_set, length);
+    } break;
+
     default:
       return false;
   }
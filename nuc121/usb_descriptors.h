@@ -47,6 +47,14 @@ enum
 {
   USB_VENDORHID_IN = 1,
   USB_VENDORHID_OUT = 2,
+  USB_DAPBULK_IN = 3,
+  USB_DAPBULK_OUT = 4,
+};
+
+enum
+{
+  USB_MS_OS_20_VENDOR_CODE = 0x01,
+  USB_MS_OS_20_DESCRIPTOR_INDEX = 0x07,
 };
 
 /*- Types -------------------------------------------------------------------*/
@@ -57,11 +65,15 @@ typedef struct PACK
   usb_hid_descriptor_t            hid;
   usb_endpoint_descriptor_t       ep_in;
   usb_endpoint_descriptor_t       ep_out;
+  usb_interface_descriptor_t      bulk_interface;
+  usb_endpoint_descriptor_t       bulk_ep_out;
+  usb_endpoint_descriptor_t       bulk_ep_in;
 } usb_configuration_hierarchy_t;
 
 //-----------------------------------------------------------------------------
 extern const usb_device_descriptor_t usb_device_descriptor;
 extern const usb_configuration_hierarchy_t usb_configuration_hierarchy;
+extern const uint8_t usb_bos_descriptor[33];
 extern const usb_string_descriptor_zero_t usb_string_descriptor_zero;
 extern const char *const usb_strings[];
 extern char usb_serial_number[16];
@@ -107,6 +107,12 @@ bool usb_handle_standard_request(usb_request_t *request)
           return false;
         }
       }
+      else if (USB_BINARY_OBJECT_STORE_DESCRIPTOR == type)
+      {
+        length = LIMIT(length, sizeof(usb_bos_descriptor));
+
+        usb_control_send((uint8_t *)usb_bos_descriptor, length);
+      }
       else
       {
         return false;
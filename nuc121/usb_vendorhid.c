@@ -29,17 +29,53 @@
 /*- Includes ----------------------------------------------------------------*/
 #include <stdbool.h>
 #include <string.h>
+#include "NUC121.h"
 #include "utils.h"
 #include "usb.h"
 #include "dm.h"
 
+/*- Types -------------------------------------------------------------------*/
+// Vendor HID and CMSIS-DAP v2 bulk each have their own queue of DAP commands;
+// the free-running indices are each only ever advanced by one context:
+// rx_index by the OUT callback (in USBD_IRQHandler), dap_index and tx_index by usb_vendorhid_task();
+// a USB reset or reconfiguration rewinds them all from the ISR, and bumps generation so that
+// usb_vendorhid_task() knows to discard a command it was executing at the time
+typedef struct
+{
+  uint8_t request[DAP_PACKET_COUNT][DAP_PACKET_SIZE];
+  uint8_t response[DAP_PACKET_COUNT][DAP_PACKET_SIZE];
+  uint16_t request_length[DAP_PACKET_COUNT];
+  uint16_t length[DAP_PACKET_COUNT];
+  volatile uint8_t rx_index, dap_index, tx_index;
+  volatile bool epin_pending, epout_paused;
+  volatile uint8_t generation;
+  // HID reports are always full-size, whereas bulk responses carry only their actual length
+  bool bulk;
+  int ep_in, ep_out;
+} dap_queue_t;
+
 /*- Prototypes --------------------------------------------------------------*/
 static void usb_vendorhid_epin_callback(uint8_t *data, int size);
 static void usb_vendorhid_epout_callback(uint8_t *data, int size);
+static void usb_dapbulk_epin_callback(uint8_t *data, int size);
+static void usb_dapbulk_epout_callback(uint8_t *data, int size);
 
 /*- Variables ---------------------------------------------------------------*/
-static uint8_t dap_buffer[DAP_PACKET_SIZE];
-static volatile bool epout_pending, epin_pending;
+static dap_queue_t vendorhid_queue =
+{
+  .bulk = false,
+  .ep_in = USB_VENDORHID_IN,
+  .ep_out = USB_VENDORHID_OUT,
+};
+
+static dap_queue_t dapbulk_queue =
+{
+  .bulk = true,
+  .ep_in = USB_DAPBULK_IN,
+  .ep_out = USB_DAPBULK_OUT,
+};
+
+#define DAP_SLOT(queue, array, index)  (queue)->array[(index) % DAP_PACKET_COUNT]
 
 /*- Implementations ---------------------------------------------------------*/
 
@@ -48,39 +84,107 @@ void usb_vendorhid_init(void)
 {
   usb_set_callback(USB_VENDORHID_IN, usb_vendorhid_epin_callback);
   usb_set_callback(USB_VENDORHID_OUT, usb_vendorhid_epout_callback);
+  usb_set_callback(USB_DAPBULK_IN, usb_dapbulk_epin_callback);
+  usb_set_callback(USB_DAPBULK_OUT, usb_dapbulk_epout_callback);
 }
 
-void usb_vendorhid_task(void)
+static void dap_queue_task(dap_queue_t *queue)
 {
-  if (!epout_pending)
-    return;
+  // execute the oldest pending command; dap_handler() writes the response straight into the slot that usb_send() reads
+  if (queue->dap_index != queue->rx_index)
+  {
+    uint8_t generation = queue->generation;
+    int index = queue->dap_index % DAP_PACKET_COUNT;
+    int length = dap_handler(queue->request[index], queue->request_length[index], queue->response[index], DAP_PACKET_SIZE);
 
-  if (epin_pending)
+    __disable_irq();
+    if (generation == queue->generation)
+    {
+      queue->length[index] = queue->bulk ? length : DAP_PACKET_SIZE;
+      queue->dap_index++;
+    }
+    __enable_irq();
+  }
+
+  // the rest shares the IN endpoint and the paused OUT endpoint with the ISR, and is brief
+  __disable_irq();
+
+  if (queue->epin_pending || (queue->tx_index == queue->dap_index))
+  {
+    __enable_irq();
     return;
+  }
+
+  // usb_send() copies the response into the USBD SRAM, so the slot is free again afterwards
+  queue->epin_pending = true;
+  usb_send(queue->ep_in, DAP_SLOT(queue, response, queue->tx_index), queue->length[queue->tx_index % DAP_PACKET_COUNT]);
+  queue->tx_index++;
+
+  // if the OUT callback stalled reception for want of a free slot, resume it
+  if (queue->epout_paused)
+  {
+    queue->epout_paused = false;
+    usb_recv(queue->ep_out, DAP_PACKET_SIZE);
+  }
 
-  dap_handler(dap_buffer);
-  usb_send(USB_VENDORHID_IN, dap_buffer, DAP_PACKET_SIZE);
-  usb_recv(USB_VENDORHID_OUT, DAP_PACKET_SIZE);
-  epin_pending = true;
-  epout_pending = false;
+  __enable_irq();
+}
+
+void usb_vendorhid_task(void)
+{
+  dap_queue_task(&vendorhid_queue);
+  dap_queue_task(&dapbulk_queue);
+}
+
+static void dap_queue_epout(dap_queue_t *queue, uint8_t *data, int size)
+{
+  // the command is only executed later from usb_vendorhid_task(), so it has to be copied out of the USBD SRAM
+  memcpy(DAP_SLOT(queue, request, queue->rx_index), data, size);
+  DAP_SLOT(queue, request_length, queue->rx_index) = size;
+  queue->rx_index++;
+
+  // accept the next command straight away if there is a free slot
+  if ((uint8_t)(queue->rx_index - queue->tx_index) < DAP_PACKET_COUNT)
+    usb_recv(queue->ep_out, DAP_PACKET_SIZE);
+  else
+    queue->epout_paused = true;
+}
+
+static void dap_queue_reset(dap_queue_t *queue)
+{
+  queue->epin_pending = queue->epout_paused = false;
+  queue->rx_index = queue->dap_index = queue->tx_index = 0;
+  queue->generation++;
+  usb_recv(queue->ep_out, DAP_PACKET_SIZE);
 }
 
 static void usb_vendorhid_epin_callback(uint8_t *data, int size)
 {
   (void)data;
   (void)size;
-  epin_pending = false;
+  vendorhid_queue.epin_pending = false;
 }
 
 static void usb_vendorhid_epout_callback(uint8_t *data, int size)
 {
-  memcpy(dap_buffer, data, size);
-  epout_pending = true;
+  dap_queue_epout(&vendorhid_queue, data, size);
+}
+
+static void usb_dapbulk_epin_callback(uint8_t *data, int size)
+{
+  (void)data;
+  (void)size;
+  dapbulk_queue.epin_pending = false;
+}
+
+static void usb_dapbulk_epout_callback(uint8_t *data, int size)
+{
+  dap_queue_epout(&dapbulk_queue, data, size);
 }
 
 void usb_configuration_callback(int config)
 {
-  epin_pending = epout_pending = false;
-  usb_recv(USB_VENDORHID_OUT, DAP_PACKET_SIZE);
+  dap_queue_reset(&vendorhid_queue);
+  dap_queue_reset(&dapbulk_queue);
   (void)config;
 }
@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include "swdio_bsp.h"
 #include "dm_bsp.h"
+#include "dm.h"
 
 /*
 In approaching this code, it is important to understand that this 
@@ -30,13 +31,22 @@ Said microcontroller is 8-bit and lacks a stack.
 As a result, variables all deal with 8-bit quantities.  Parameters 
 are primarily passed via shared variables rather than as function 
 arguments.
+
+32-bit targets can instead define DAP_USE_WORD_SHIFT in dm_bsp.h; 
+each SWD transaction in dap_transfer() is then a single call to 
+swd_transaction(), which shifts with shift_word_out()/shift_word_in(). 
+These take register arguments, handle up to 32 bits per call, and 
+compute parity from the whole word rather than incrementing a shared 
+counter on every bit.  Where the board wires SWCLK/SWDIO to a SPI 
+peripheral, DAP_USE_SPI_ENGINE additionally substitutes a 
+board-specific swd_transaction() that shifts in hardware.
 */
 
 /*
 Theory of operation:
 
-an external device-specific USB Vendor HID implementation calls 
-dap_handler() in this file.  This and additional support functions 
+an external device-specific USB implementation (Vendor HID and/or 
+CMSIS-DAP v2 bulk) calls dap_handler() in this file.  This and additional support functions 
 local to this file perform the CMSIS-DAP functionality.
 
 Processor and board-specific access to GPIO pins is abstracted
@@ -52,6 +62,23 @@ static uint8_t flags;
 #define FLAG_OMITREQUESTDECODE 0x04
 #define FLAG_BUSFAULT          0x08
 #define FLAG_WRITEABORT        0x10
+#define FLAG_POSTEDREAD        0x20
+
+/* set by DAP_TransferConfigure and DAP_SWD_Configure */
+static uint8_t idle_cycles = 8;
+static uint8_t turnaround = 1;
+static uint8_t data_phase;
+static uint16_t wait_retry = 8;
+static uint16_t match_retry = 64;
+
+/* set by dap_handler() to the last place in the caller's response buffer that four bytes of read data can go */
+static uint8_t *response_limit;
+
+/* set by dap_handler() to just past the end of the caller's request, which no command's data may run beyond */
+static const uint8_t *request_end;
+
+/* set by dap_handler() to the size of the caller's response buffer, which is the packet size reported by DAP_Info */
+static uint16_t packet_size;
 
 /* shifts MIN(out_count,8) bits of data, LSB first */
 
@@ -157,13 +184,426 @@ static uint8_t shift_bits_in(uint8_t count)
 	return result;
 }
 
+/* leave bus in the "IDLE" state, per DDI 0316D, for as many cycles as DAP_TransferConfigure asked */
+
+static void shift_idle(void)
+{
+	out_count = idle_cycles;
+
+	while (out_count)
+		shift_bits_out(0x00);
+}
+
+#if defined(DAP_USE_SPI_ENGINE) && !defined(DAP_USE_WORD_SHIFT)
+#error DAP_USE_SPI_ENGINE requires DAP_USE_WORD_SHIFT
+#endif
+
+#if defined(DAP_USE_POSTED_WRITES) && !defined(DAP_USE_WORD_SHIFT)
+#error DAP_USE_POSTED_WRITES requires DAP_USE_WORD_SHIFT
+#endif
+
+#if defined(DAP_SUPPORT_MEMORY_ACCESS) && !defined(DAP_USE_WORD_SHIFT)
+#error DAP_SUPPORT_MEMORY_ACCESS requires DAP_USE_WORD_SHIFT
+#endif
+
+#if defined(DAP_USE_REGISTER_SHADOW) && !defined(DAP_USE_WORD_SHIFT)
+#error DAP_USE_REGISTER_SHADOW requires DAP_USE_WORD_SHIFT
+#endif
+
+#if defined(DAP_SUPPORT_EVENTS) && !(defined(DAP_SUPPORT_MEMORY_ACCESS) && defined(DAP_USE_REGISTER_SHADOW))
+#error DAP_SUPPORT_EVENTS requires DAP_SUPPORT_MEMORY_ACCESS and DAP_USE_REGISTER_SHADOW
+#endif
+
+#ifdef DAP_USE_REGISTER_SHADOW
+
+/*
+a write-through copy of SELECT, and of the CSW and TAR of the MEM-AP that it selects; a write that would leave one of these
+as it already is is acknowledged without touching the wire; anything that might have changed them behind our back 
+(DAP_Connect, a line reset or other sequence, ABORT, a FAULT or protocol error, or a power-down request) forgets them
+*/
+
+#define SHADOW_SELECT          0x01
+#define SHADOW_CSW             0x02
+#define SHADOW_TAR             0x04
+
+#define SHADOW_RESET           shadow_valid = 0
+
+static uint32_t shadow_select, shadow_csw, shadow_tar;
+static uint8_t shadow_valid;
+
+/* whether CSW or TAR (as "which") is known; they are only tracked whilst SELECT is known to address bank 0 */
+
+static uint8_t shadow_known(uint8_t which)
+{
+	return ((SHADOW_SELECT | which) == (shadow_valid & (SHADOW_SELECT | which))) && (0 == (shadow_select & 0xF0));
+}
+
+/* whether the SWD write "request" of "data" would leave SELECT, CSW or TAR as it already is */
+
+static uint8_t shadow_hit(uint8_t request, uint32_t data)
+{
+	switch ((request >> 1) & 0x0F)
+	{
+	case 0x08: /* WriteDP[2] SELECT */
+		return (shadow_valid & SHADOW_SELECT) && (shadow_select == data);
+	case 0x01: /* WriteAP[0] CSW */
+		return shadow_known(SHADOW_CSW) && (shadow_csw == data);
+	case 0x05: /* WriteAP[1] TAR */
+		return shadow_known(SHADOW_TAR) && (shadow_tar == data);
+	}
+
+	return 0;
+}
+
+/* accounts for the SWD transaction "request" having been answered with "ack" */
+
+static void shadow_update(uint8_t request, uint32_t data, uint8_t ack)
+{
+	uint32_t tar;
+
+	/* nothing happened on a WAIT, but a FAULT or protocol error leaves us unsure of anything */
+	if (2 /* WAIT */ == ack)
+		return;
+	if (1 /* OK */ != (ack & 0x07))
+	{
+		SHADOW_RESET;
+		return;
+	}
+
+	switch ((request >> 1) & 0x0F)
+	{
+	case 0x00: /* WriteDP[0] ABORT */
+		SHADOW_RESET;
+		break;
+	case 0x04: /* WriteDP[1] CTRL/STAT */
+		/* without CDBGPWRUPREQ, the debug domain (and so the AP) may be powered down */
+		if (0 == (data & 0x10000000UL))
+			SHADOW_RESET;
+		break;
+	case 0x08: /* WriteDP[2] SELECT */
+		/* CSW and TAR are only tracked for one AP, and only from when SELECT is known */
+		if ( (0 == (shadow_valid & SHADOW_SELECT)) || ((shadow_select ^ data) & 0xFF000000UL) )
+			shadow_valid = 0;
+		shadow_select = data;
+		shadow_valid |= SHADOW_SELECT;
+		break;
+	}
+
+	/* the remaining registers of interest are all in bank 0 of the AP */
+	if ( (0 == (request & 0x02)) || !shadow_known(0) )
+		return;
+
+	switch ((request >> 1) & 0x0F)
+	{
+	case 0x01: /* WriteAP[0] CSW */
+		shadow_csw = data;
+		shadow_valid |= SHADOW_CSW;
+		break;
+	case 0x05: /* WriteAP[1] TAR */
+		shadow_tar = data;
+		shadow_valid |= SHADOW_TAR;
+		break;
+	case 0x0D: /* WriteAP[3] DRW */
+	case 0x0F: /* ReadAP[3] DRW */
+		/* TAR is followed through an auto-increment, up to the 1KB boundary beyond which ADIv5 leaves it undefined */
+		if (shadow_known(SHADOW_CSW | SHADOW_TAR))
+		{
+			if (0x00 == (shadow_csw & 0x30))
+				break;
+
+			tar = shadow_tar + (1UL << (shadow_csw & 0x07));
+			if ( (0x10 == (shadow_csw & 0x30)) && (0 == ((tar ^ shadow_tar) & ~0x3FFUL)) )
+			{
+				shadow_tar = tar;
+				break;
+			}
+		}
+		shadow_valid &= ~SHADOW_TAR;
+		break;
+	}
+}
+
+#else
+
+#define SHADOW_RESET
+
+#endif /* DAP_USE_REGISTER_SHADOW */
+
+#ifdef DAP_USE_WORD_SHIFT
+
+/* parity of a 32-bit word: fold down to a nibble, then look it up in a 16-entry bit table */
+
+static inline uint32_t word_parity(uint32_t value)
+{
+	value ^= value >> 16;
+	value ^= value >> 8;
+	value ^= value >> 4;
+	return (0x6996 >> (value & 0x0F)) & 0x01;
+}
+
+#if !defined(DAP_USE_SPI_ENGINE) || defined(DAP_USE_POSTED_WRITES)
+
+/* shifts "count" (at most 32) bits of data, LSB first */
+
+static void shift_word_out(uint32_t data, uint32_t count)
+{
+	/* drive both clock and data */
+	DATA_ENABLE;
+
+	while (count--)
+	{
+		CLK_LOW;
+		if (data & 0x01)
+		{
+			DATA_HIGH;
+		}
+		else
+		{
+			DATA_LOW;
+		}
+		data >>= 1;
+		CLK_HIGH;
+	}
+
+	CLK_LOW;
+}
+
+/* read "count" bits and return them LSB first; bits beyond the 32nd are clocked but discarded */
+
+static uint32_t shift_word_in(uint32_t count)
+{
+	uint32_t result, bit;
+
+	DATA_HIZ; /* tristate data */
+
+	result = 0;
+	bit = 0x01;
+
+	while (count--)
+	{
+		CLK_LOW;
+		asm("nop");
+		if (DATA_READ)
+			result |= bit;
+		bit <<= 1;
+		CLK_HIGH;
+	}
+
+	CLK_LOW;
+
+	return result;
+}
+
+#endif
+
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+the board support code provides swd_transaction() (declared in swdio_bsp.h), shifting with a SPI peripheral;
+it leaves the pins configured for shift_bits_out()/shift_bits_in() afterwards, and only supports the default
+DAP_SWD_Configure settings (one turnaround cycle, no data phase on WAIT/FAULT)
+*/
+
+#else
+
+/* performs a complete SWD transaction: request, ACK, and any data phase; the caller adds any idle cycles */
+/* returns the ACK, with 0x08 ORed in if the parity of read data was wrong; "data" is read from or written to as appropriate */
+
+static uint8_t swd_transaction(uint8_t request, uint32_t *data)
+{
+	uint8_t ack;
+	uint32_t value;
+
+	shift_word_out(request, 8);
+
+	/* turnaround plus three cycles of ACK */
+	ack = (shift_word_in(turnaround + 3) >> turnaround) & 0x07;
+
+	if (1 /* OK */ != ack)
+	{
+		/* if DAP_SWD_Configure asked for it, a dummy data phase (Figure 2-4 DDI 0316D) */
+		if (data_phase && (request & 0x04))
+			shift_word_in(33);
+		shift_word_in(turnaround);
+		if (data_phase && !(request & 0x04))
+		{
+			shift_word_out(0x00, 32);
+			shift_word_out(0x00, 1);
+		}
+		return ack;
+	}
+
+	if (request & 0x04)
+	{
+		/* read: data, then parity bit and end turnaround */
+		value = shift_word_in(32);
+		*data = value;
+		if ((shift_word_in(1 + turnaround) ^ word_parity(value)) & 0x01)
+			ack |= 0x08;
+	}
+	else
+	{
+		/* write: turnaround, then data and parity bit */
+		value = *data;
+		shift_word_in(turnaround);
+		shift_word_out(value, 32);
+		shift_word_out(word_parity(value), 1);
+	}
+
+	return ack;
+}
+
+#endif /* DAP_USE_SPI_ENGINE */
+
+#ifdef DAP_USE_POSTED_WRITES
+
+#ifndef DAP_POSTED_WRITE_MIN
+#define DAP_POSTED_WRITE_MIN   24 /* below this, bracketing the block with CTRL/STAT accesses costs more than it saves */
+#endif
+
+#define CTRLSTAT_ORUNDETECT    0x00000001UL
+#define CTRLSTAT_STICKYORUN    0x00000002UL
+#define CTRLSTAT_STICKYERR     0x00000020UL
+#define CTRLSTAT_WDATAERR      0x00000080UL
+#define CTRLSTAT_WRITABLE      0x54FFFF0DUL
+
+/* the last value written to CTRL/STAT (so as to keep the power-up requests); zero if it must be read back first */
+static uint32_t ctrlstat_shadow;
+
+/* a write transaction with overrun detection enabled: the data phase follows whatever the ACK, and no idle cycles are added */
+
+static uint8_t posted_write(uint8_t request, uint32_t data)
+{
+	uint8_t ack;
+
+	shift_word_out(request, 8);
+
+	/* turnaround plus three cycles of ACK */
+	ack = (shift_word_in(turnaround + 3) >> turnaround) & 0x07;
+
+	/* turnaround, then data and parity bit */
+	shift_word_in(turnaround);
+	shift_word_out(data, 32);
+	shift_word_out(word_parity(data), 1);
+
+	return ack;
+}
+
+/*
+streams "count" words of a DAP_TransferBlock write to an AP back to back, with ORUNDETECT set in CTRL/STAT for the duration;
+the sticky flags are then checked once, at the end of the block, rather than the ACK being acted upon for every word
+returns OK if all words were written; otherwise "done" is the number of words written before the one that failed,
+with WAIT meaning that the target merely refused that word (and the caller should carry on from it the normal way)
+*/
+
+static uint8_t posted_write_block(uint8_t swd_request, const uint8_t *input, uint8_t count, uint8_t *done)
+{
+	uint32_t ctrlstat, status, data;
+	uint8_t ack;
+
+	*done = 0;
+
+	if (0 == ctrlstat_shadow)
+	{
+		if (1 /* OK */ != swd_transaction(0x8D /* ReadDP[1] */, &ctrlstat_shadow))
+			return 2 /* WAIT */;
+		ctrlstat_shadow &= CTRLSTAT_WRITABLE;
+	}
+
+	ctrlstat = ctrlstat_shadow;
+	data = ctrlstat | CTRLSTAT_ORUNDETECT;
+	if (1 /* OK */ != swd_transaction(0xA9 /* WriteDP[1] */, &data))
+		return 2 /* WAIT */;
+
+	ack = 1 /* OK */;
+	while (*done < count)
+	{
+		data = (uint32_t)input[0] | ((uint32_t)input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+		ack = posted_write(swd_request, data);
+		if (1 /* OK */ != ack)
+			break;
+		input += 4;
+		(*done)++;
+	}
+
+#ifdef DAP_USE_REGISTER_SHADOW
+	/* the ACKs of a posted block don't say which words were written, so TAR (and whatever else was written) is forgotten */
+	shadow_valid &= SHADOW_SELECT;
+#endif
+
+	status = 0;
+	swd_transaction(0x8D /* ReadDP[1] */, &status);
+
+	/* an overrun is of our own making, so it is cleared here; anything else is left for the host to see */
+	if (status & CTRLSTAT_STICKYORUN)
+	{
+		data = 0x10; /* ORUNERRCLR */
+		swd_transaction(0x81 /* WriteDP[0] ABORT */, &data);
+	}
+
+	swd_transaction(0xA9 /* WriteDP[1] */, &ctrlstat);
+	shift_idle();
+
+	if (status & (CTRLSTAT_STICKYERR | CTRLSTAT_WDATAERR))
+	{
+		/* a posted write that failed with the last word's ACK already given is attributed to that last word */
+		if (*done == count)
+			(*done)--;
+		return 4 /* FAULT */;
+	}
+
+	if ( (1 /* OK */ != ack) && (2 /* WAIT */ != ack) )
+		return 4 /* FAULT */;
+
+	return ack;
+}
+
+#endif /* DAP_USE_POSTED_WRITES */
+
+#endif /* DAP_USE_WORD_SHIFT */
+
+/* form the 8-bit SWD request (with start, parity, stop and park bits) from the lower nibble of a "Transfer Request" */
+
+static uint8_t swd_request_from(uint8_t transfer_request)
+{
+	uint8_t request;
+
+#ifdef DAP_USE_WORD_SHIFT
+	parity = word_parity(transfer_request & 0x0F);
+#else
+	parity = 0;
+	if (transfer_request & 0x01)
+		parity++;
+	if (transfer_request & 0x02)
+		parity++;
+	if (transfer_request & 0x04)
+		parity++;
+	if (transfer_request & 0x08)
+		parity++;
+#endif
+
+	request = transfer_request & 0x0F;
+	request <<= 1;
+	request |= (parity & 0x01) ? 0xA1 : 0x81;
+
+	return request;
+}
+
 /* grand unification that achieves DAP_Transfer, DAP_TransferBlock, and DAP_WriteABORT */
+/* returns the number of response bytes written to "output" */
 
-static void dap_transfer(const uint8_t *input, uint8_t *output)
+static uint16_t dap_transfer(const uint8_t *input, uint8_t *output)
 {
-	uint8_t transfer_count, transfer_request, swd_request, ack, retry_count;
+	uint8_t transfer_count, transfer_request, swd_request, ack;
+	uint16_t retry_count, match_count;
 	uint8_t *response_count;
 	static uint8_t mask_value[4], match_value[4];
+#ifdef DAP_USE_WORD_SHIFT
+	uint32_t data = 0;
+#endif
+#ifdef DAP_USE_POSTED_WRITES
+	uint8_t posted;
+#endif
 
 	response_count = output;
 	(*response_count) = 0;
@@ -186,8 +626,13 @@ static void dap_transfer(const uint8_t *input, uint8_t *output)
 
 	while (transfer_count)
 	{
-		/* reset retry count for this go-around */
+		/* a malformed request asking for more read data than the response can hold is cut short, rather than overrunning it */
+		if ( (output > response_limit) && (((flags & FLAG_OMITREQUESTDECODE) ? transfer_request : *input) & 0x02) )
+			break;
+
+		/* reset retry counts for this go-around */
 		retry_count = 0;
+		match_count = 0;
 
 		if (0 == (flags & FLAG_OMITREQUESTDECODE))
 		{
@@ -225,25 +670,12 @@ static void dap_transfer(const uint8_t *input, uint8_t *output)
 				goto finish_transfer;
 			}
 
-			/* compute parity for "swd_request" */
-			parity = 0;
-			if (transfer_request & 0x01)
-				parity++;
-			if (transfer_request & 0x02)
-				parity++;
-			if (transfer_request & 0x04)
-				parity++;
-			if (transfer_request & 0x08)
-				parity++;
-
 			/* reads from AP are pipelined, so we must signal this to the ensuing code */
 			if (0x03 == (transfer_request & 0x03))
 				flags |= FLAG_PIPELINEDAPREAD;
 
 			/* form 8-bit SWD request ("swd_request") from "transfer_request" */
-			swd_request = transfer_request & 0x0F;
-			swd_request <<= 1;
-			swd_request |= (parity & 0x01) ? 0xA1 : 0x81;
+			swd_request = swd_request_from(transfer_request);
 
 			/*
 			in a DAP_TransferBlock, one transfer_request/swd_request applies to all transfers
@@ -251,23 +683,119 @@ static void dap_transfer(const uint8_t *input, uint8_t *output)
 			*/
 			if (flags & FLAG_TRANSFERBLOCK)
 				flags |= FLAG_OMITREQUESTDECODE;
+
+#ifdef DAP_USE_POSTED_WRITES
+			/* a large enough DAP_TransferBlock write to an AP is streamed; see posted_write_block() */
+			if ( (flags & FLAG_TRANSFERBLOCK) && (0x01 == (transfer_request & 0x03)) && (transfer_count >= DAP_POSTED_WRITE_MIN) )
+			{
+				ack = posted_write_block(swd_request, input, transfer_count, &posted);
+				input += 4 * posted;
+
+				/* as with any other transfer, the last word is accounted for at finish_transfer */
+				if (1 /* OK */ == ack)
+					posted--;
+				(*response_count) += posted;
+				transfer_count -= posted;
+
+				if (1 /* OK */ == ack)
+					goto finish_transfer;
+
+				if (4 /* FAULT */ == ack)
+				{
+					flags |= FLAG_BUSFAULT;
+					goto finish_transfer;
+				}
+
+				/* otherwise, the word that was refused (and any after it) are written the normal way */
+			}
+#endif
+
+			/* the previous transfer already issued this ReadAP in collecting its own result, so only the collection remains */
+			if (flags & FLAG_POSTEDREAD)
+			{
+				flags &= ~FLAG_POSTEDREAD;
+				goto collect_posted_read;
+			}
 		}
 
 start_of_request:
+#ifdef DAP_USE_WORD_SHIFT
+		if (0 == (transfer_request & 0x22))
+			data = (uint32_t)input[0] | ((uint32_t)input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+
+#ifdef DAP_USE_REGISTER_SHADOW
+		if (shadow_hit(swd_request, data))
+		{
+			input += 4;
+			ack = 1 /* OK */;
+			goto finish_transfer;
+		}
+#endif
+
+		ack = swd_transaction(swd_request, &data);
+
+#ifdef DAP_USE_REGISTER_SHADOW
+		shadow_update(swd_request, data, ack);
+#endif
+
+		if (2 /* WAIT */ == ack)
+		{
+			if (retry_count++ < wait_retry)
+				goto start_of_request;
+			else
+				goto finish_transfer;
+		}
+
+		if (1 /* OK */ != (ack & 0x07))
+		{
+			/* the ACK was unrecognized / FAULT, so we bail */
+			flags |= FLAG_BUSFAULT;
+			ack = 4 /* FAULT */;
+			goto finish_transfer;
+		}
+
+		if (0 == (transfer_request & 0x22))
+		{
+			input += 4;
+#ifdef DAP_USE_POSTED_WRITES
+			if (0x04 /* WriteDP[1] */ == (transfer_request & 0x0F))
+				ctrlstat_shadow = data & CTRLSTAT_WRITABLE;
+#endif
+		}
+		else
+		{
+			output[0] = (uint8_t)(data >> 0);
+			output[1] = (uint8_t)(data >> 8);
+			output[2] = (uint8_t)(data >> 16);
+			output[3] = (uint8_t)(data >> 24);
+			if (ack & 0x08)
+				ack = 0x08; /* not ORed so as to be consistent with reference implementation */
+		}
+#else
 		/* shift out 8-bits of SWD request */
 		out_count = 8;
 		shift_bits_out(swd_request);
 
-		/* one cycle turnaround plus three cycles of ACK */
-		ack = shift_bits_in(4);
+		/* turnaround plus three cycles of ACK */
+		ack = shift_bits_in(turnaround + 3);
 		ack &= 0xE0;
 		ack >>= 5;
 
 		if (2 /* WAIT */ == ack)
 		{
-			retry_count++;
-			shift_bits_in(1); /* turnaround cycle (Figure 2-4 DDI 0316D) */
-			if (retry_count < 8)
+			/* if DAP_SWD_Configure asked for it, a dummy data phase (Figure 2-4 DDI 0316D) */
+			if (data_phase && (swd_request & 0x04))
+				shift_bits_in(33);
+			shift_bits_in(turnaround);
+			if (data_phase && !(swd_request & 0x04))
+			{
+				out_count = 33;
+				do
+				{
+					shift_bits_out(0x00);
+				} while (out_count);
+			}
+			if (retry_count++ < wait_retry)
 				goto start_of_request;
 			else
 				goto finish_transfer;
@@ -284,7 +812,7 @@ start_of_request:
 		if (0 == (transfer_request & 0x22))
 		{
 			/* write */
-			shift_bits_in(1); /* turnaround cycle */
+			shift_bits_in(turnaround);
 			parity = 0;
 			out_count = 33;
 			shift_bits_out(*input++);
@@ -304,25 +832,40 @@ start_of_request:
 			shift_bits_in(1); /* parity */
 			if (parity & 0x01)
 				ack = 0x08; /* not ORed so as to be consistent with reference implementation */
-			shift_bits_in(1); /* end turnaround */
+			shift_bits_in(turnaround); /* end turnaround */
 		}
+#endif
 
-		/* leave bus in the "IDLE" state, per DDI 0316D */
-		out_count = 8;
-		shift_bits_out(0x00);
+		shift_idle();
 
-		/* if the transaction is a ReadAP[3] and is the last, morph to a ReadDP[3] */
-		if (0x9F == swd_request)
+		/* in a DAP_TransferBlock, if the transaction is a ReadAP[3] and is the last, morph to a ReadDP[3] */
+		if ( (0x9F == swd_request) && (flags & FLAG_TRANSFERBLOCK) )
 			if (
-				( (0 == (flags & FLAG_TRANSFERBLOCK)) && (flags & FLAG_PIPELINEDAPREAD) ) ||
-				(  (flags & FLAG_TRANSFERBLOCK) && (1 == transfer_count) && (flags & FLAG_PIPELINEDAPREAD) ) || 
-				(  (flags & FLAG_TRANSFERBLOCK) && (2 == transfer_count) && (0 == (flags & FLAG_PIPELINEDAPREAD)) )
+				( (1 == transfer_count) && (flags & FLAG_PIPELINEDAPREAD) ) || 
+				( (2 == transfer_count) && (0 == (flags & FLAG_PIPELINEDAPREAD)) )
 			)
 				swd_request = 0xBD;
 
 		if (flags & FLAG_PIPELINEDAPREAD)
 		{
+collect_posted_read:
 			flags &= ~FLAG_PIPELINEDAPREAD;
+
+			/*
+			in a DAP_Transfer, the result of a ReadAP is collected by the next transaction:
+			if the next transfer is also a plain ReadAP, that is issued now (and its own result posted in turn);
+			otherwise, it is a ReadDP[3] (RDBUFF), so N consecutive ReadAPs cost N+1 transactions
+			*/
+			if (0 == (flags & FLAG_TRANSFERBLOCK))
+			{
+				swd_request = 0xBD;
+				if ( (transfer_count > 1) && (0x03 == (transfer_request & 0x13)) && (0x03 == (*input & 0x13)) )
+				{
+					swd_request = swd_request_from(*input);
+					flags |= FLAG_POSTEDREAD;
+				}
+			}
+
 			goto start_of_request;
 		}
 
@@ -335,8 +878,15 @@ start_of_request:
 				( match_value[3] != (output[3] & mask_value[3]) )
 			)
 			{
-				if (++retry_count < 64)
+				if (match_count++ < match_retry)
+				{
+					/* "swd_request" may now be the RDBUFF that collected the result, so the read itself is issued afresh */
+					retry_count = 0;
+					swd_request = swd_request_from(transfer_request);
+					if (transfer_request & 0x01)
+						flags |= FLAG_PIPELINEDAPREAD;
 					goto start_of_request;
+				}
 				ack |= 0x10;
 			}
 		}
@@ -365,6 +915,12 @@ finish_transfer:
 		if (0x02 == (transfer_request & 0x12))
 			output += 4;
 	}
+
+	/* DAP_WriteABORT only has a status byte; otherwise, "output" has advanced past any read data */
+	if (flags & FLAG_WRITEABORT)
+		return 1;
+
+	return output - response_count;
 }
 
 static void swj_pins(const uint8_t *input, uint8_t *output)
@@ -403,76 +959,1088 @@ static void swj_pins(const uint8_t *input, uint8_t *output)
 	}
 }
 
-void dap_handler(uint8_t *RxDataBuffer)
-{
-	static uint8_t scratchpad[DAP_PACKET_SIZE + 4]; /* buffer is oversized by 4 to allow for simpler code in dap_transfer() */
-
-	/* pre-fill the response with an echo back of the command */
-	scratchpad[0] = RxDataBuffer[0];
-	scratchpad[1] = 0x00;
-	scratchpad[2] = 0x00;
+/* DAP_Connect: drive SWCLK and SWDIO, and leave RESET to the target */
 
-	switch (RxDataBuffer[0])
+static void swd_connect(void)
+{
+	SWDIO_INIT;
+	DATA_ENABLE;
+	CLK_ENABLE;
+	CLK_LOW;
+	RESET_HIZ;
+}
+
+#ifdef DAP_SUPPORT_ATTACH
+
+/* line reset, JTAG-to-SWD select sequence, line reset, then idle cycles */
+static const uint8_t attach_sequence[] = { 136, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x9E, 0xE7, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+/* the "Transfer Count" and "Transfer Request"s of a DAP_Transfer */
+static const uint8_t attach_transfer[] =
+{
+	7,
+	0x02,                         /* ReadDP[0] IDCODE, which must follow a line reset */
+	0x00, 0x1E, 0x00, 0x00, 0x00, /* WriteDP[0] ABORT: clear any sticky flags */
+	0x08, 0x00, 0x00, 0x00, 0x00, /* WriteDP[2] SELECT: bank 0 of AP 0 */
+	0x04, 0x00, 0x00, 0x00, 0x50, /* WriteDP[1] CTRL/STAT: CSYSPWRUPREQ and CDBGPWRUPREQ */
+	0x20, 0x00, 0x00, 0x00, 0xA0, /* match mask: CSYSPWRUPACK and CDBGPWRUPACK */
+	0x16, 0x00, 0x00, 0x00, 0xA0, /* ReadDP[1] CTRL/STAT until both ACKs are set, as DAP_TransferConfigure's match retry allows */
+	0x06,                         /* ReadDP[1] CTRL/STAT */
+};
+
+/*
+ID_DAP_Vendor3: the request is the command and a byte whose bit 0 asks for RESET to be asserted throughout (and left asserted,
+for the host to release with DAP_SWJ_Pins once it has caught the core); the probe then does what a DAP_Connect,
+DAP_SWJ_Sequence and DAP_Transfer would to attach and power-up the debug domain; the response is that of the DAP_Transfer:
+the command, the count of transfers done (seven if all went well), the ACK of the last, then IDCODE and CTRL/STAT
+*/
+
+static uint16_t swd_attach(const uint8_t *request, uint8_t *response)
+{
+	swd_connect();
+
+	if (request[1] & 0x01)
+	{
+		RESET_ENABLE;
+		RESET_LOW;
+	}
+
+	swj_sequence(attach_sequence);
+	SHADOW_RESET;
+
+	flags = 0x00;
+	return 1 + dap_transfer(attach_transfer, response + 1);
+}
+
+#endif /* DAP_SUPPORT_ATTACH */
+
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+
+/*
+vendor commands that access target memory through the MEM-AP that SELECT addresses (as it would be for DAP_TransferBlock);
+the probe programs CSW and TAR itself, so the host need not split accesses at the 1KB boundaries beyond which 
+ADIv5 does not guarantee that TAR auto-increments
+*/
+
+#define TAR_WRAP               0x400UL
+#define CSW_SIZE_ADDRINC_MASK  0x00000037UL
+#define CSW_ADDRINC_SINGLE     0x00000010UL /* ORed with the access size: 0 for bytes, 1 for halfwords, 2 for words */
+#define CSW_SIZE32             0x00000002UL
+
+/* a single transaction, with any WAITs retried as DAP_TransferConfigure asked; returns the ACK as dap_transfer() would report it */
+
+static uint8_t mem_transaction(uint8_t request, uint32_t *data)
+{
+	uint16_t retry_count = 0;
+	uint8_t ack;
+
+#ifdef DAP_USE_REGISTER_SHADOW
+	if (shadow_hit(request, *data))
+		return 1 /* OK */;
+#endif
+
+	for (;;)
+	{
+		ack = swd_transaction(request, data);
+#ifdef DAP_USE_REGISTER_SHADOW
+		shadow_update(request, *data, ack);
+#endif
+		shift_idle();
+
+		if ( (2 /* WAIT */ != ack) || (retry_count++ >= wait_retry) )
+			break;
+	}
+
+	if ( (1 /* OK */ != (ack & 0x07)) && (2 /* WAIT */ != ack) )
+	{
+		/* the ACK was unrecognized / FAULT */
+		shift_bits_in(100);
+		return 4 /* FAULT */;
+	}
+
+	return (ack & 0x08) ? 0x08 : ack;
+}
+
+/* CSW is only rewritten if its size and auto-increment fields aren't already as "mode" gives them; returns the ACK */
+
+static uint8_t csw_setup(uint8_t mode)
+{
+	uint32_t data;
+	uint8_t ack;
+
+#ifdef DAP_USE_REGISTER_SHADOW
+	/* there is no need to read CSW back if it is already known, and once read, it is known */
+	if (shadow_known(SHADOW_CSW))
+	{
+		data = shadow_csw;
+		ack = 1 /* OK */;
+	}
+	else
+#endif
+	{
+		ack = mem_transaction(0x87 /* ReadAP[0] CSW */, &data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, &data);
+#ifdef DAP_USE_REGISTER_SHADOW
+		if ( (1 /* OK */ == ack) && shadow_known(0) )
+		{
+			shadow_csw = data;
+			shadow_valid |= SHADOW_CSW;
+		}
+#endif
+	}
+
+	if ( (1 /* OK */ == ack) && (mode != (data & CSW_SIZE_ADDRINC_MASK)) )
+	{
+		data = (data & ~CSW_SIZE_ADDRINC_MASK) | mode;
+		ack = mem_transaction(0xA3 /* WriteAP[0] CSW */, &data);
+	}
+
+	return ack;
+}
+
+/*
+ID_DAP_Vendor0: the request is the command, 0x00 to write or 0x01 to read, a 32-bit word-aligned address, and a 16-bit word count,
+followed (for a write) by the data; the response is laid out as for DAP_TransferBlock: the command, the 16-bit count of words
+transferred, the ACK of the last transaction, then (for a read) the data; a write is cut short to the data that the request holds
+
+ID_DAP_Vendor2 is the same, but for elements of the size in bits 5:4 of the byte after the command (0 for bytes, 1 for halfwords, 
+2 for words), at an address aligned to that size; the data is packed, with the probe doing the byte-lane shifting
+*/
+
+static uint16_t memory_block(const uint8_t *input, uint8_t *output, uint8_t size)
+{
+	uint32_t address, data;
+	uint16_t count, done, chunk, avail;
+	uint8_t *pnt;
+	uint8_t read, ack, bytes, lane;
+#ifdef DAP_USE_POSTED_WRITES
+	uint8_t posted;
+#endif
+
+	read = input[1] & 0x01;
+	address = (uint32_t)input[2] | ((uint32_t)input[3] << 8) | ((uint32_t)input[4] << 16) | ((uint32_t)input[5] << 24);
+	count = input[6] | ((uint16_t)input[7] << 8);
+	input += 8;
+
+	pnt = output + 4;
+	done = 0;
+	bytes = 1 << size;
+
+	/* a read is cut short to what the response can hold */
+	if ( read && (count > (response_limit + 4 - pnt) / bytes) )
+		count = (response_limit + 4 - pnt) / bytes;
+
+	/* and a write to the data that the request holds */
+	if (!read)
+	{
+		avail = (request_end > input) ? (request_end - input) / bytes : 0;
+		if (count > avail)
+			count = avail;
+	}
+
+	ack = csw_setup(CSW_ADDRINC_SINGLE | size);
+
+	while ( (1 /* OK */ == ack) && (done < count) )
+	{
+		/* TAR is written once for each run of elements that it will auto-increment across */
+		chunk = (TAR_WRAP - (address & (TAR_WRAP - 1))) >> size;
+		if (chunk > count - done)
+			chunk = count - done;
+
+		data = address;
+		ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &data);
+
+		if (read)
+		{
+			/* AP reads are posted: each returns the result of the one before it, and RDBUFF collects the last */
+			if (1 /* OK */ == ack)
+				ack = mem_transaction(0x9F /* ReadAP[3] DRW */, &data);
+
+			while ( (1 /* OK */ == ack) && chunk )
+			{
+				ack = mem_transaction((--chunk) ? 0x9F /* ReadAP[3] DRW */ : 0xBD /* ReadDP[3] RDBUFF */, &data);
+				if (1 /* OK */ != ack)
+					break;
+
+				/* the element is in the byte lanes of its address */
+				data >>= 8 * (address & 0x03);
+				for (lane = 0; lane < bytes; lane++)
+				{
+					*pnt++ = (uint8_t)data;
+					data >>= 8;
+				}
+				address += bytes;
+				done++;
+			}
+		}
+		else
+		{
+#ifdef DAP_USE_POSTED_WRITES
+			/* as in dap_transfer(), a long enough run of words is streamed */
+			if ( (1 /* OK */ == ack) && (2 == size) && (chunk >= DAP_POSTED_WRITE_MIN) )
+			{
+				ack = posted_write_block(0xBB /* WriteAP[3] DRW */, input, (chunk > 255) ? 255 : chunk, &posted);
+				input += 4 * posted;
+				address += 4 * posted;
+				done += posted;
+				chunk -= posted;
+
+				/* the word that was refused (and any after it) are written the normal way */
+				if (2 /* WAIT */ == ack)
+					ack = 1 /* OK */;
+			}
+#endif
+
+			while ( (1 /* OK */ == ack) && chunk )
+			{
+				data = 0;
+				for (lane = bytes; lane--;)
+					data = (data << 8) | input[lane];
+				data <<= 8 * (address & 0x03);
+
+				ack = mem_transaction(0xBB /* WriteAP[3] DRW */, &data);
+				if (1 /* OK */ != ack)
+					break;
+
+				input += bytes;
+				address += bytes;
+				done++;
+				chunk--;
+			}
+		}
+	}
+
+	output[1] = (uint8_t)(done >> 0);
+	output[2] = (uint8_t)(done >> 8);
+	output[3] = ack;
+
+	return pnt - output;
+}
+
+/*
+ID_DAP_Vendor1: the request is the command, an 8-bit count, and that many 32-bit word-aligned addresses;
+the response is the command, the count of words read, the ACK of the last transaction, then the words read
+*/
+
+static uint16_t memory_gather(const uint8_t *input, uint8_t *output)
+{
+	uint32_t data;
+	uint8_t *pnt;
+	uint8_t count, done, ack;
+
+	count = input[1];
+	input += 2;
+
+	pnt = output + 3;
+	done = 0;
+
+	/* cut short to what the response can hold, which may be no words at all at the end of a batch */
+	if (count > (response_limit + 4 - pnt) / 4)
+		count = (response_limit + 4 - pnt) / 4;
+
+	ack = csw_setup(CSW_ADDRINC_SINGLE | CSW_SIZE32);
+
+	/*
+	AP reads are posted, and an AP write leaves the result of the last one waiting in RDBUFF; so each ReadAP DRW
+	returns the word at the address before it, and the next TAR write overlaps it, with RDBUFF collecting the last
+	*/
+	while ( (1 /* OK */ == ack) && (done < count) )
+	{
+		data = (uint32_t)input[0] | ((uint32_t)input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+		input += 4;
+
+		ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0x9F /* ReadAP[3] DRW */, &data);
+		if (1 /* OK */ != ack)
+			break;
+
+		if (done++)
+		{
+			pnt[0] = (uint8_t)(data >> 0);
+			pnt[1] = (uint8_t)(data >> 8);
+			pnt[2] = (uint8_t)(data >> 16);
+			pnt[3] = (uint8_t)(data >> 24);
+			pnt += 4;
+		}
+	}
+
+	if (done)
+	{
+		/* an error leaves the word last read in doubt, so it is neither collected nor counted */
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, &data);
+		if (1 /* OK */ == ack)
+		{
+			pnt[0] = (uint8_t)(data >> 0);
+			pnt[1] = (uint8_t)(data >> 8);
+			pnt[2] = (uint8_t)(data >> 16);
+			pnt[3] = (uint8_t)(data >> 24);
+			pnt += 4;
+		}
+		else
+		{
+			done--;
+		}
+	}
+
+	output[1] = done;
+	output[2] = ack;
+
+	return pnt - output;
+}
+
+/*
+"elapsed" is the microseconds since timer_start(), as accumulated by timer_update() from the BSP's free-running TIMER_READ; 
+the timer is shared by every user, so TIMER_INIT is only done the once
+*/
+
+struct timer
+{
+	uint32_t elapsed, ticks, last;
+};
+
+static void timer_start(struct timer *timer)
+{
+	static uint8_t running;
+
+	if (!running)
+	{
+		TIMER_INIT;
+		running = 1;
+	}
+
+	timer->last = TIMER_READ;
+	timer->elapsed = timer->ticks = 0;
+}
+
+/* this must be called more often than TIMER_READ wraps */
+
+static void timer_update(struct timer *timer)
+{
+	uint32_t now;
+
+	now = TIMER_READ;
+	timer->ticks += (now - timer->last) & TIMER_MASK;
+	timer->last = now;
+
+	timer->elapsed += timer->ticks / TIMER_TICKS_PER_US;
+	timer->ticks %= TIMER_TICKS_PER_US;
+}
+
+static uint32_t get_word(const uint8_t *pnt)
+{
+	return (uint32_t)pnt[0] | ((uint32_t)pnt[1] << 8) | ((uint32_t)pnt[2] << 16) | ((uint32_t)pnt[3] << 24);
+}
+
+static void put_word(uint8_t *pnt, uint32_t value)
+{
+	pnt[0] = (uint8_t)(value >> 0);
+	pnt[1] = (uint8_t)(value >> 8);
+	pnt[2] = (uint8_t)(value >> 16);
+	pnt[3] = (uint8_t)(value >> 24);
+}
+
+/*
+ID_DAP_Vendor4: the request is the command, then the 32-bit word-aligned address, mask, match value, poll interval and timeout
+(both in microseconds); the word at the address is read until it matches under the mask, with at least the interval between reads,
+and a last read at the timeout; the response is the command, DAP_OK if it matched (DAP_ERROR otherwise), the ACK of the last
+transaction, the microseconds elapsed, and the last value read
+*/
+
+static uint16_t memory_wait(const uint8_t *input, uint8_t *output)
+{
+	uint32_t data, mask, match, interval, timeout, start;
+	struct timer timer;
+	uint8_t ack;
+
+	/* the response is a fixed eleven bytes, which a batch may not have left room for */
+	if (output + 11 > response_limit + 4)
+	{
+		output[1] = 0xFF; /* DAP_ERROR */
+		return 2;
+	}
+
+	mask = get_word(input + 5);
+	match = get_word(input + 9);
+	interval = get_word(input + 13);
+	timeout = get_word(input + 17);
+
+	output[1] = 0xFF; /* DAP_ERROR */
+
+	/* with auto-increment off, TAR need only be written the once */
+	ack = csw_setup(CSW_SIZE32);
+	if (1 /* OK */ == ack)
+	{
+		data = get_word(input + 1);
+		ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &data);
+	}
+
+	data = 0;
+	timer_start(&timer);
+
+	while (1 /* OK */ == ack)
+	{
+		ack = mem_transaction(0x9F /* ReadAP[3] DRW */, &data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, &data);
+		timer_update(&timer);
+
+		if (1 /* OK */ != ack)
+			break;
+
+		if (match == (data & mask))
+		{
+			output[1] = 0x00; /* DAP_OK */
+			break;
+		}
+
+		if (timer.elapsed >= timeout)
+			break;
+
+		start = timer.elapsed;
+		while ( (timer.elapsed - start < interval) && (timer.elapsed < timeout) )
+			timer_update(&timer);
+	}
+
+	output[2] = ack;
+	put_word(output + 3, timer.elapsed);
+	put_word(output + 7, data);
+
+	return 11;
+}
+
+/* the Cortex-M debug registers through which the core's registers are accessed whilst it is halted */
+
+#define DHCSR_ADDRESS          0xE000EDF0UL
+#define DCRSR_ADDRESS          0xE000EDF4UL
+#define DCRDR_ADDRESS          0xE000EDF8UL
+#define DHCSR_S_REGRDY         0x00010000UL
+#define DCRSR_REGWNR           0x00010000UL
+
+/* writes "data" to the word at "address"; returns the ACK */
+
+static uint8_t core_write(uint32_t address, uint32_t data)
+{
+	uint8_t ack;
+
+	ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &address);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0xBB /* WriteAP[3] DRW */, &data);
+
+	return ack;
+}
+
+/* reads the word at "address" into "data"; returns the ACK */
+
+static uint8_t core_read(uint32_t address, uint32_t *data)
+{
+	uint8_t ack;
+
+	ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &address);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0x9F /* ReadAP[3] DRW */, data);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, data);
+
+	return ack;
+}
+
+/* polls DHCSR until S_REGRDY says the DCRSR transfer is done; as with DAP_Transfer's match, 0x10 is added to the ACK if match_retry ran out */
+
+static uint8_t core_wait(void)
+{
+	uint32_t data;
+	uint16_t match_count = 0;
+	uint8_t ack;
+
+	data = DHCSR_ADDRESS;
+	ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &data);
+	while (1 /* OK */ == ack)
+	{
+		ack = mem_transaction(0x9F /* ReadAP[3] DRW */, &data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, &data);
+		if ( (1 /* OK */ != ack) || (data & DHCSR_S_REGRDY) )
+			break;
+		if (match_count++ >= match_retry)
+			return ack | 0x10;
+	}
+
+	return ack;
+}
+
+/*
+ID_DAP_Vendor6 (read) and ID_DAP_Vendor7 (write): the request is the command, the REGSEL of DCRSR for bit 0 of the mask, 
+and a 32-bit mask of the registers to transfer (so 0 and 0x0007FFFF give R0 to R12, SP, LR, the return address, xPSR, 
+MSP and PSP), followed (for a write) by their values in turn; the core must already be halted; the response is the command, 
+the count of registers transferred, the ACK of the last transaction, then (for a read) their values, with a read cut short 
+to what the response can hold, and a write to the values that the request holds (a 64-byte packet has room for 14)
+*/
+
+static uint16_t core_registers(const uint8_t *input, uint8_t *output)
+{
+	uint32_t mask, data;
+	const uint8_t *values;
+	uint8_t *pnt;
+	uint8_t regsel, write, done, ack;
+
+	write = (0x87 == input[0]);
+	regsel = input[1];
+	mask = get_word(input + 2);
+	values = input + 6;
+
+	pnt = output + 3;
+	done = 0;
+
+	/* without auto-increment, as TAR is rewritten for each access */
+	ack = csw_setup(CSW_SIZE32);
+
+	for (; mask && (1 /* OK */ == ack); mask >>= 1, regsel++)
+	{
+		if (0 == (mask & 1))
+			continue;
+
+		if (write)
+		{
+			if (request_end - values < 4)
+				break;
+
+			ack = core_write(DCRDR_ADDRESS, get_word(values));
+			values += 4;
+			if (1 /* OK */ == ack)
+				ack = core_write(DCRSR_ADDRESS, DCRSR_REGWNR | regsel);
+			if (1 /* OK */ == ack)
+				ack = core_wait();
+		}
+		else
+		{
+			if (pnt > response_limit)
+				break;
+
+			ack = core_write(DCRSR_ADDRESS, regsel);
+			if (1 /* OK */ == ack)
+				ack = core_wait();
+			if (1 /* OK */ == ack)
+				ack = core_read(DCRDR_ADDRESS, &data);
+			if (1 /* OK */ == ack)
+			{
+				put_word(pnt, data);
+				pnt += 4;
+			}
+		}
+
+		if (1 /* OK */ == ack)
+			done++;
+	}
+
+	output[1] = done;
+	output[2] = ack;
+
+	return pnt - output;
+}
+
+#endif /* DAP_SUPPORT_MEMORY_ACCESS */
+
+#ifdef DAP_SUPPORT_EVENTS
+
+/*
+a monitor that samples the DHCSR of a Cortex-M core whilst the host has no command outstanding, so that a halt, lockup
+or reset can be reported to it without it polling; the transport calls dap_event_poll() from its idle loop, and sends
+on whatever that returns; SELECT, and the CSW and TAR of the AP that it selects, are put back as they were, which is
+why the register shadow is needed (SELECT cannot be read back), and a sample is skipped until the host has written SELECT
+*/
+
+#define DHCSR_S_HALT           0x00020000UL
+#define DHCSR_S_LOCKUP         0x00080000UL
+#define DHCSR_S_RESET_ST       0x02000000UL
+
+#define EVENT_HALTED           0x01
+#define EVENT_LOCKUP           0x02
+#define EVENT_RESET            0x04
+#define EVENT_STOPPED          0x80
+
+static struct timer event_timer;
+static uint32_t event_select, event_interval;
+static uint8_t event_armed, event_last;
+
+/*
+ID_DAP_Vendor5: the request is the command, the APSEL of the core's MEM-AP, and the 16-bit interval in milliseconds between samples 
+(zero stopping the monitor); the response is the command and DAP_OK
+*/
+
+static uint16_t event_arm(const uint8_t *input, uint8_t *output)
+{
+	event_select = (uint32_t)input[1] << 24;
+	event_interval = 1000UL * (input[2] | ((uint16_t)input[3] << 8));
+	event_armed = (0 != event_interval);
+	event_last = 0xFF; /* the first sample is always reported */
+
+	timer_start(&event_timer);
+
+	output[1] = 0x00; /* DAP_OK */
+	return 2;
+}
+
+/* reads DHCSR into "data"; returns the ACK, or zero if a sticky flag (that the host has yet to see) or a powered down debug domain means it was left alone */
+
+static uint8_t event_sample(uint32_t *data)
+{
+	uint32_t select, csw, tar;
+	uint8_t ack;
+
+	ack = mem_transaction(0x8D /* ReadDP[1] CTRL/STAT */, data);
+	if (1 /* OK */ != ack)
+		return ack;
+	if ( (*data & 0xB2UL /* STICKYORUN, STICKYCMP, STICKYERR, WDATAERR */) || (0 == (*data & 0x20000000UL /* CDBGPWRUPACK */)) )
+		return 0;
+
+	select = shadow_select;
+	*data = event_select;
+	ack = mem_transaction(0xB1 /* WriteDP[2] SELECT */, data);
+
+	/* CSW and TAR are read back, unless the shadow already has them, so that they can be restored */
+	if ( (1 /* OK */ == ack) && !shadow_known(SHADOW_CSW) )
+	{
+		ack = mem_transaction(0x87 /* ReadAP[0] CSW */, data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, data);
+		shadow_csw = *data;
+		shadow_valid |= (1 /* OK */ == ack) ? SHADOW_CSW : 0;
+	}
+	if ( (1 /* OK */ == ack) && !shadow_known(SHADOW_TAR) )
+	{
+		ack = mem_transaction(0xAF /* ReadAP[1] TAR */, data);
+		if (1 /* OK */ == ack)
+			ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, data);
+		shadow_tar = *data;
+		shadow_valid |= (1 /* OK */ == ack) ? SHADOW_TAR : 0;
+	}
+	csw = shadow_csw;
+	tar = shadow_tar;
+
+	if (1 /* OK */ == ack)
+		ack = csw_setup(CSW_SIZE32);
+	if (1 /* OK */ == ack)
+	{
+		*data = DHCSR_ADDRESS;
+		ack = mem_transaction(0x8B /* WriteAP[1] TAR */, data);
+	}
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0x9F /* ReadAP[3] DRW */, data);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0xBD /* ReadDP[3] RDBUFF */, data);
+
+	/* the shadow turns each of these into a no-op where nothing was changed */
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0x8B /* WriteAP[1] TAR */, &tar);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0xA3 /* WriteAP[0] CSW */, &csw);
+	if (1 /* OK */ == ack)
+		ack = mem_transaction(0xB1 /* WriteDP[2] SELECT */, &select);
+
+	return ack;
+}
+
+/*
+called by the transport whilst it has no command to execute, and no earlier report still waiting to be collected; 
+this returns the length of the report that it wrote to "report" (zero if there is nothing to send), which is an event byte 
+(EVENT_HALTED and EVENT_LOCKUP as DHCSR has them, EVENT_RESET if S_RESET_ST was set, and EVENT_STOPPED if the monitor stopped 
+on a failed transaction), the ACK of the last transaction, and DHCSR; a report is only made when the halt or lockup state changes, 
+or a reset is seen; as DHCSR's S_RESET_ST (and S_RETIRE_ST) clear on being read, the host should not rely on them itself
+*/
+
+uint8_t dap_event_poll(uint8_t *report)
+{
+	uint32_t dhcsr;
+	uint8_t ack, events;
+
+	if (!event_armed)
+		return 0;
+
+	timer_update(&event_timer);
+	if (event_timer.elapsed < event_interval)
+		return 0;
+	timer_start(&event_timer);
+
+	if (0 == (shadow_valid & SHADOW_SELECT))
+		return 0;
+
+	ack = event_sample(&dhcsr);
+	if (0 == ack)
+		return 0;
+
+	events = 0;
+	if (1 /* OK */ == ack)
+	{
+		if (dhcsr & DHCSR_S_HALT)
+			events |= EVENT_HALTED;
+		if (dhcsr & DHCSR_S_LOCKUP)
+			events |= EVENT_LOCKUP;
+		if ( (events == event_last) && !(dhcsr & DHCSR_S_RESET_ST) )
+			return 0;
+		event_last = events;
+		if (dhcsr & DHCSR_S_RESET_ST)
+			events |= EVENT_RESET;
+	}
+	else
+	{
+		/* SELECT, CSW and TAR may not have been restored, so the host must treat them as unknown, as after any FAULT */
+		events = EVENT_STOPPED;
+		event_armed = 0;
+		dhcsr = 0;
+	}
+
+	report[0] = events;
+	report[1] = ack;
+	put_word(report + 2, dhcsr);
+
+	return DAP_EVENT_REPORT_SIZE;
+}
+
+#endif /* DAP_SUPPORT_EVENTS */
+
+/*
+the length of the command at "request", or zero if it is not one that can be batched by DAP_ExecuteCommands; if the bytes that 
+its length depends upon run past "end", this is instead one more than there are, so that it is always more than the caller has; 
+"response_max" is set to the most that the command can write to the response, leaving aside read data that the command already 
+cuts short to what the response can hold; this is also called from a transport's USB interrupt, so must only use its arguments
+*/
+
+static uint32_t command_length(const uint8_t *request, const uint8_t *end, uint8_t *response_max)
+{
+	const uint8_t *pnt;
+	uint16_t size;
+	uint8_t count, bits;
+
+	if (request >= end)
+		return 1;
+	size = end - request;
+
+	/* dap_command() pre-fills three bytes of every response, and DAP_Info can add a fourth */
+	*response_max = 4;
+
+	switch (request[0])
+	{
+	case 0x00: /* DAP_Info */
+	case 0x02: /* DAP_Connect */
+	case 0x13: /* DAP_SWD_Configure */
+	case 0x16: /* DAP_JTAG_IDCODE */
+		return 2;
+	case 0x01: /* DAP_HostStatus */
+	case 0x09: /* DAP_Delay */
+		return 3;
+	case 0x03: /* DAP_Disconnect */
+	case 0x07: /* DAP_TransferAbort */
+	case 0x0A: /* DAP_ResetTarget */
+		return 1;
+	case 0x04: /* DAP_TransferConfigure */
+	case 0x08: /* DAP_WriteABORT */
+		return 6;
+	case 0x05: /* DAP_Transfer */
+		if (size < 3)
+			return size + 1;
+		pnt = request + 3;
+		for (count = request[2]; count; count--)
+		{
+			if (pnt >= end)
+				return size + 1;
+			/* writes carry data (or a match mask), and reads may carry a match value */
+			if ( (0 == (*pnt & 0x02)) || (*pnt & 0x10) )
+				pnt += 4;
+			pnt++;
+		}
+		return pnt - request;
+	case 0x06: /* DAP_TransferBlock */
+		if (size < 5)
+			return size + 1;
+		if (request[4] & 0x02)
+			return 5;
+		return 5 + 4UL * (request[2] | ((uint16_t)request[3] << 8));
+	case 0x10: /* DAP_SWJ_Pins */
+		return 7;
+	case 0x11: /* DAP_SWJ_Clock */
+		return 5;
+	case 0x12: /* DAP_SWJ_Sequence */
+		if (size < 2)
+			return size + 1;
+		return 2 + (request[1] ? (request[1] + 7) / 8 : 32);
+	case 0x14: /* DAP_JTAG_Sequence */
+		if (size < 2)
+			return size + 1;
+		pnt = request + 2;
+		for (count = request[1]; count; count--)
+		{
+			if (pnt >= end)
+				return size + 1;
+			bits = *pnt++ & 0x3F;
+			pnt += bits ? (bits + 7) / 8 : 8;
+		}
+		return pnt - request;
+	case 0x15: /* DAP_JTAG_Configure */
+		if (size < 2)
+			return size + 1;
+		return 2 + request[1];
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	case 0x80: /* ID_DAP_Vendor0: memory block */
+		if (size < 8)
+			return size + 1;
+		if (request[1] & 0x01)
+			return 8;
+		return 8 + 4UL * (request[6] | ((uint16_t)request[7] << 8));
+	case 0x81: /* ID_DAP_Vendor1: memory gather */
+		if (size < 2)
+			return size + 1;
+		return 2 + 4 * request[1];
+	case 0x82: /* ID_DAP_Vendor2: sized memory block */
+		if (size < 8)
+			return size + 1;
+		if (request[1] & 0x01)
+			return 8;
+		return 8 + ((uint32_t)(request[6] | ((uint16_t)request[7] << 8)) << ((request[1] >> 4) & 0x03));
+#endif
+#ifdef DAP_SUPPORT_ATTACH
+	case 0x83: /* ID_DAP_Vendor3: attach */
+		return 2;
+#endif
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	case 0x84: /* ID_DAP_Vendor4: wait */
+		*response_max = 11;
+		return 21;
+	case 0x86: /* ID_DAP_Vendor6: read core registers */
+		return 6;
+	case 0x87: /* ID_DAP_Vendor7: write core registers */
+		if (size < 6)
+			return size + 1;
+		pnt = request + 2;
+		count = 0;
+		for (bits = 0; bits < 32; bits++)
+			count += (pnt[bits / 8] >> (bits % 8)) & 1;
+		return 6 + 4 * count;
+#endif
+#ifdef DAP_SUPPORT_EVENTS
+	case 0x85: /* ID_DAP_Vendor5: event monitor */
+		return 4;
+#endif
+	}
+
+	return 0;
+}
+
+/*
+for a transport that receives a packet as several USB packets: the length of the command (or DAP_ExecuteCommands batch) at 
+"request", of which the first "length" bytes have arrived; this is more than "length" whilst there is more to come, and zero 
+for a command whose length cannot be worked out, which the transport should take to end with the USB packet
+*/
+
+uint32_t dap_request_length(const uint8_t *request, uint16_t length)
+{
+	const uint8_t *end;
+	uint32_t total, next;
+	uint8_t count, response_max;
+
+	end = request + length;
+	total = command_length(request, end, &response_max);
+	if ( total || ((0x7F /* DAP_ExecuteCommands */ != request[0]) && (0x7E /* DAP_QueueCommands */ != request[0])) )
+		return total;
+
+	if (length < 2)
+		return length + 1;
+
+	/* as in dap_handler(), a batch ends at a command that cannot be batched */
+	total = 2;
+	for (count = request[1]; count && (total <= length); count--)
+	{
+		next = command_length(request + total, end, &response_max);
+		if (0 == next)
+			break;
+		total += next;
+	}
+
+	return total;
+}
+
+/* executes a single command; the return value is the response length */
+
+static uint16_t dap_command(const uint8_t *request, uint8_t *response)
+{
+	uint16_t response_length;
+
+	/* pre-fill the response with an echo back of the command */
+	response[0] = request[0];
+	response[1] = 0x00;
+	response[2] = 0x00;
+
+	/* most responses consist of the command and a single status byte */
+	response_length = 2;
+
+	switch (request[0])
 	{
 	case 0x00: /* DAP_Info */
-		switch (RxDataBuffer[1])
+		switch (request[1])
 		{
 		case 0xF0: /* Capabilities */
-			scratchpad[1] = 0x01; /* len of byte */
-			scratchpad[2] = 0x01; /* Capabilities: SWD only */
+			response[1] = 0x01; /* len of byte */
+			response[2] = 0x01; /* Capabilities: SWD only */
 			break;
 		case 0xFE: /* Packet Count */
-			scratchpad[1] = 0x01; /* len of byte */
-			scratchpad[2] = DAP_PACKET_COUNT;
+			response[1] = 0x01; /* len of byte */
+			response[2] = DAP_PACKET_COUNT;
 			break;
 		case 0xFF: /* Packet Size */
-			scratchpad[1] = 0x02; /* len of short */
-			scratchpad[2] = DAP_PACKET_SIZE >> 0;
-			scratchpad[3] = DAP_PACKET_SIZE >> 8;
+			response[1] = 0x02; /* len of short */
+			response[2] = (uint8_t)(packet_size >> 0);
+			response[3] = (uint8_t)(packet_size >> 8);
 			break;
 		}
+		response_length += response[1];
 		break;
 	case 0x02: /* DAP_Connect */
-		scratchpad[1] = 0x01;
-		SWDIO_INIT;
-		DATA_ENABLE;
-		CLK_ENABLE;
-		CLK_LOW;
-		RESET_HIZ;
+		response[1] = 0x01;
+		SHADOW_RESET;
+		swd_connect();
 		break;
 	case 0x03: /* DAP_Disconnect */
 		DATA_HIZ;
 		CLK_HIZ;
 		RESET_HIZ;
+#ifdef DAP_SUPPORT_EVENTS
+		event_armed = 0;
+#endif
+		break;
+	case 0x04: /* DAP_TransferConfigure */
+		idle_cycles = request[1];
+		wait_retry = request[2] | ((uint16_t)request[3] << 8);
+		match_retry = request[4] | ((uint16_t)request[5] << 8);
 		break;
 	case 0x05: /* DAP_Transfer */
 		flags = 0x00;
-		dap_transfer(RxDataBuffer + 2, scratchpad + 1);
+		response_length = 1 + dap_transfer(request + 2, response + 1);
 		break;
 	case 0x06: /* DAP_TransferBlock */
 		flags = FLAG_TRANSFERBLOCK;
-		dap_transfer(RxDataBuffer + 2, scratchpad + 1);
+		response_length = 1 + dap_transfer(request + 2, response + 1);
 		break;
 	case 0x08: /* DAP_WriteABORT */
 		flags = FLAG_WRITEABORT | FLAG_OMITREQUESTDECODE;
-		dap_transfer(RxDataBuffer + 2, scratchpad + 1);
+		response_length = 1 + dap_transfer(request + 2, response + 1);
 		break;
 	case 0x10: /* DAP_SWJ_Pins */
-		swj_pins(RxDataBuffer + 1, scratchpad + 1);
+		swj_pins(request + 1, response + 1);
 		break;
 	case 0x12: /* DAP_SWJ_Sequence */
-		swj_sequence(RxDataBuffer + 1);
+		swj_sequence(request + 1);
+		SHADOW_RESET;
+		break;
+	case 0x13: /* DAP_SWD_Configure */
+#ifdef DAP_USE_SPI_ENGINE
+		if (request[1])
+		{
+			response[1] = 0xFF; /* DAP_ERROR */
+			break;
+		}
+#endif
+		turnaround = (request[1] & 0x03) + 1;
+		data_phase = request[1] & 0x04;
 		break;
 	case 0x14: /* DAP_JTAG_Sequence */
 #ifdef DAP_SUPPORT_JTAG_SEQUENCE
-		jtag_sequence(RxDataBuffer + 1);
+		jtag_sequence(request + 1);
+		SHADOW_RESET;
 		break;
 #endif
 	case 0x15: /* DAP_JTAG_Configure */
 	case 0x16: /* DAP_JTAG_IDCODE */
-		scratchpad[1] = 0xFF; /* DAP_ERROR */
+		response[1] = 0xFF; /* DAP_ERROR */
+		break;
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	case 0x80: /* ID_DAP_Vendor0: memory block */
+		response_length = memory_block(request, response, 2);
+		break;
+	case 0x81: /* ID_DAP_Vendor1: memory gather */
+		response_length = memory_gather(request, response);
+		break;
+	case 0x82: /* ID_DAP_Vendor2: sized memory block */
+		if (0x30 == (request[1] & 0x30))
+		{
+			response[1] = 0xFF; /* DAP_ERROR */
+			break;
+		}
+		response_length = memory_block(request, response, (request[1] >> 4) & 0x03);
+		break;
+#endif
+#ifdef DAP_SUPPORT_ATTACH
+	case 0x83: /* ID_DAP_Vendor3: attach */
+		response_length = swd_attach(request, response);
+		break;
+#endif
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	case 0x84: /* ID_DAP_Vendor4: wait */
+		response_length = memory_wait(request, response);
 		break;
+	case 0x86: /* ID_DAP_Vendor6: read core registers */
+	case 0x87: /* ID_DAP_Vendor7: write core registers */
+		response_length = core_registers(request, response);
+		break;
+#endif
+#ifdef DAP_SUPPORT_EVENTS
+	case 0x85: /* ID_DAP_Vendor5: event monitor */
+		response_length = event_arm(request, response);
+		break;
+#endif
+	}
+
+	return response_length;
+}
+
+/*
+the command is parsed straight out of "request" and the response built straight into "response", so these must not overlap;
+the return value is the response length, which a bulk transport should use as-is but a HID transport ignores 
+(as it always sends full-size reports); "response_size" is the transport's packet size, which may span several USB 
+packets, and is what DAP_Info reports to the host
+*/
+
+uint16_t dap_handler(const uint8_t *request, uint16_t request_length, uint8_t *response, uint16_t response_size)
+{
+	uint8_t *output;
+	uint32_t length;
+	uint8_t count, response_max;
+
+	if (0 == request_length)
+		return 0;
+
+	/* dap_transfer() stops short of writing read data beyond this */
+	response_limit = response + response_size - 4;
+	packet_size = response_size;
+	request_end = request + request_length;
+
+	if ( (0x7F /* DAP_ExecuteCommands */ != request[0]) && (0x7E /* DAP_QueueCommands */ != request[0]) )
+		return dap_command(request, response);
+
+	/*
+	the batched commands are executed back to back, with their responses concatenated in turn; 
+	the transports already execute each packet as soon as it arrives, whilst the host still has others in flight, 
+	so DAP_QueueCommands is executed straight away too, and (as in the reference implementation) answered as DAP_ExecuteCommands; 
+	the batch is cut short at a command that cannot be batched, overruns the request, or might overrun the response
+	*/
+	count = (request_length > 1) ? request[1] : 0;
+	request += 2;
+
+	response[0] = 0x7F;
+	response[1] = 0;
+	output = response + 2;
+
+	while (count--)
+	{
+		length = command_length(request, request_end, &response_max);
+		if ( (0 == length) || (length > (uint32_t)(request_end - request)) || (output + response_max > response_limit + 4) )
+			break;
+
+		output += dap_command(request, output);
+		request += length;
+		response[1]++;
 	}
 
-	memcpy(RxDataBuffer, scratchpad, DAP_PACKET_SIZE);
+	return output - response;
 }
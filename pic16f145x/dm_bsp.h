@@ -4,9 +4,10 @@
 #include <xc.h>
 #include "usb_config.h" /* device-specific: for EP_1_OUT_LEN */
 
-#define DAP_PACKET_COUNT  1
+#define DAP_PACKET_COUNT  2
 #define DAP_PACKET_SIZE   EP_1_OUT_LEN
 
 #define DAP_SUPPORT_JTAG_SEQUENCE
+#define DAP_SUPPORT_ATTACH /* vendor attach command; see swd_attach() in dm.c */
 
 #endif /* __DM_BSP_H */
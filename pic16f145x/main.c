@@ -30,14 +30,96 @@
 since this is a downloaded app, configuration words (e.g. __CONFIG or #pragma config) are not relevant
 */
 
+#ifdef DAP_USE_PING_PONG
+
+/*
+the ping-pong OUT buffers take the place of the command ring below; this is bumped (in the ISR) on every 
+SET_CONFIGURATION, so that a response to a command that straddled a reconfiguration is discarded
+*/
+static volatile uint8_t configuration_generation;
+
+#else
+
+/*
+commands are copied out of the EP1 OUT buffer into this ring so that the endpoint can be re-armed straight away, 
+letting the PC have DAP_PACKET_COUNT commands in flight rather than waiting a USB frame between each one
+*/
+static uint8_t command[DAP_PACKET_COUNT][EP_1_OUT_LEN];
+
+/*
+CMSIS-DAP v1 (HID) commands arrive on EP1 and CMSIS-DAP v2 (bulk) commands on EP2; both share the ring above, 
+with each slot remembering which endpoint its response must go back on, and how much of it was received
+*/
+static uint8_t command_ep[DAP_PACKET_COUNT];
+static uint8_t command_len[DAP_PACKET_COUNT];
+
+#endif
+
+int16_t MS_OS_20_DESCRIPTOR_FUNC(const void **ptr);
+
+#ifdef DAP_USE_PING_PONG
+
 int main(void)
 {
 	uint8_t *TxDataBuffer;
-	uint8_t *RxDataBuffer;
+	const unsigned char *RxDataBuffer;
+	uint8_t generation;
+	uint16_t length;
 
 	usb_init();
 
-	TxDataBuffer = usb_get_in_buffer(1);
+	/* usb_service() is invoked from isr() */
+	INTCONbits.PEIE = 1;
+	INTCONbits.GIE = 1;
+
+	for (;;)
+	{
+		/*
+		a command is executed once the SIE has filled the current OUT buffer and emptied the current IN buffer; 
+		meanwhile, the SIE has the other OUT buffer to receive the next command into, and the other IN buffer to 
+		send the previous response from
+		*/
+		if (!usb_is_configured() || !usb_out_endpoint_has_data(DAP_BULK_EP))
+			continue;
+
+		if (usb_in_endpoint_halted(DAP_BULK_EP) || usb_in_endpoint_busy(DAP_BULK_EP))
+			continue;
+
+		generation = configuration_generation;
+
+		/* invoke Dapper Miser implementation, straight from the OUT buffer into the IN buffer */
+		length = usb_get_out_buffer(DAP_BULK_EP, &RxDataBuffer);
+		TxDataBuffer = usb_get_in_buffer(DAP_BULK_EP);
+		length = dap_handler(RxDataBuffer, length, TxDataBuffer, EP_1_IN_LEN);
+
+		/* the endpoint state is shared with usb_service(), so hold off the USB interrupt whilst handing both buffers back */
+		PIE2bits.USBIE = 0;
+		if (usb_is_configured() && (generation == configuration_generation))
+		{
+			usb_send_in_buffer(DAP_BULK_EP, length);
+			usb_arm_out_endpoint(DAP_BULK_EP);
+		}
+		PIE2bits.USBIE = 1;
+	}
+}
+
+void app_set_configuration_callback(uint8_t configuration)
+{
+	configuration_generation++;
+	(void)configuration;
+}
+
+#else
+
+int main(void)
+{
+	uint8_t *TxDataBuffer;
+	uint8_t *RxDataBuffer;
+	uint8_t rx_index = 0, tx_index = 0;
+	uint8_t ep;
+	uint16_t length;
+
+	usb_init();
 
 	for (;;)
 	{
@@ -47,37 +129,73 @@ int main(void)
 
 		/* if USB isn't configured, there is no point in proceeding further */
 		if (!usb_is_configured())
+		{
+			rx_index = tx_index = 0;
 			continue;
-
-		/*
-		we check these *BEFORE* calling usb_out_endpoint_has_data() as the documentation indicates this 
-		must be followed usb_arm_out_endpoint() to enable reception of the next transaction
-		*/
-		if (usb_in_endpoint_halted(1) || usb_in_endpoint_busy(1))
-			continue;
-
-		/* if we pass this test, we are committed to make the usb_arm_out_endpoint() call */
-		if (!usb_out_endpoint_has_data(1))
+		}
+
+		for (ep = 1; ep <= 2; ep++)
+		{
+			/*
+			we check for a free slot *BEFORE* calling usb_out_endpoint_has_data() as the documentation indicates this 
+			must be followed usb_arm_out_endpoint() to enable reception of the next transaction
+			*/
+			if ( ((uint8_t)(rx_index - tx_index) < DAP_PACKET_COUNT) && usb_out_endpoint_has_data(ep) )
+			{
+				/* obtain a pointer to the receive buffer and the length of data contained within it */
+				length = usb_get_out_buffer(ep, &RxDataBuffer);
+
+				memcpy(command[rx_index % DAP_PACKET_COUNT], RxDataBuffer, length);
+				command_ep[rx_index % DAP_PACKET_COUNT] = ep;
+				command_len[rx_index % DAP_PACKET_COUNT] = length;
+				rx_index++;
+
+				/* re-arm the endpoint to receive the next OUT */
+				usb_arm_out_endpoint(ep);
+			}
+		}
+
+		/* nothing further to do if there are no commands or the IN endpoint is unavailable */
+		if (tx_index == rx_index)
 			continue;
 
-		/* obtain a pointer to the receive buffer and the length of data contained within it */
-		usb_get_out_buffer(1, &RxDataBuffer);
+		ep = command_ep[tx_index % DAP_PACKET_COUNT];
 
-		/* invoke Dapper Miser implementation */
-		memcpy(TxDataBuffer, RxDataBuffer, EP_1_OUT_LEN);
-		dap_handler(TxDataBuffer);
+		if (usb_in_endpoint_halted(ep) || usb_in_endpoint_busy(ep))
+			continue;
 
-		/* send a response back to the PC */
-		usb_send_in_buffer(1, EP_1_IN_LEN);
+		/* invoke Dapper Miser implementation, which writes its response straight into the IN endpoint buffer */
+		TxDataBuffer = usb_get_in_buffer(ep);
+		length = dap_handler(command[tx_index % DAP_PACKET_COUNT], command_len[tx_index % DAP_PACKET_COUNT], TxDataBuffer, EP_1_IN_LEN);
+		tx_index++;
 
-		/* re-arm the endpoint to receive the next EP1 OUT */
-		usb_arm_out_endpoint(1);
+		/* send a response back to the PC; HID reports are always full-size, whereas bulk responses carry only their actual length */
+		usb_send_in_buffer(ep, (DAP_HID_EP == ep) ? EP_1_IN_LEN : length);
 	}
 }
 
+#endif
+
 int8_t app_unknown_setup_request_callback(const struct setup_packet *setup)
 {
+	const void *desc;
+	int16_t len;
+
+	/* the MS OS 2.0 descriptor set binds WinUSB to the CMSIS-DAP v2 interface, so that no .inf file is needed on Windows */
+	if ( (0xC0 == setup->REQUEST.bmRequestType) && (MS_OS_20_VENDOR_CODE == setup->bRequest) && (MS_OS_20_DESCRIPTOR_INDEX == setup->wIndex) )
+	{
+		len = MS_OS_20_DESCRIPTOR_FUNC(&desc);
+		if (len > setup->wLength)
+			len = setup->wLength;
+		usb_send_data_stage((char *)desc, len, NULL, NULL);
+		return 0;
+	}
+
+#ifdef DAP_USE_PING_PONG
+	return -1;
+#else
 	return process_hid_setup_request(setup);
+#endif
 }
 
 void interrupt isr()
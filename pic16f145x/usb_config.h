@@ -21,13 +21,25 @@
 #ifndef USB_CONFIG_H__
 #define USB_CONFIG_H__
 
+/*
+DAP_USE_PING_PONG builds a variant that services USB from the interrupt and ping-pong buffers the DAP endpoints, so that 
+dap_handler() executes straight out of one OUT buffer (and into one IN buffer) while the SIE fills (or empties) the other; 
+the 512 bytes of dual-port RAM cannot hold ping-pong buffers for both the HID and the bulk endpoints, so this variant 
+offers only the (faster) CMSIS-DAP v2 bulk interface, on EP1
+*/
+//#define DAP_USE_PING_PONG
+
 /* Number of endpoint numbers besides endpoint zero. It's worth noting that
    and endpoint NUMBER does not completely describe an endpoint, but the
    along with the DIRECTION does (eg: EP 1 IN).  The #define below turns on
    BOTH IN and OUT endpoints for endpoint numbers (besides zero) up to the
    value specified.  For example, setting NUM_ENDPOINT_NUMBERS to 2 will
    activate endpoints EP 1 IN, EP 1 OUT, EP 2 IN, EP 2 OUT.  */
+#ifdef DAP_USE_PING_PONG
 #define NUM_ENDPOINT_NUMBERS 1
+#else
+#define NUM_ENDPOINT_NUMBERS 2
+#endif
 
 /* Only 8, 16, 32 and 64 are supported for endpoint zero length. */
 #define EP_0_LEN 8
@@ -42,6 +54,18 @@
 #define EP_2_OUT_LEN EP_2_LEN
 #define EP_2_IN_LEN  EP_2_LEN
 
+/* endpoint and interface numbers of the CMSIS-DAP v1 (HID) and v2 (bulk) interfaces */
+#ifdef DAP_USE_PING_PONG
+#define DAP_BULK_EP        1
+#define DAP_BULK_LEN       EP_1_OUT_LEN
+#define DAP_BULK_INTERFACE 0
+#else
+#define DAP_HID_EP         1
+#define DAP_BULK_EP        2
+#define DAP_BULK_LEN       EP_2_LEN
+#define DAP_BULK_INTERFACE 1
+#endif
+
 #define NUMBER_OF_CONFIGURATIONS 1
 
 /* Ping-pong buffering mode. Valid values are:
@@ -51,7 +75,12 @@
 	PPB_EPN_ONLY     - Ping-pong all endpoints except 0
 */
 
+#ifdef DAP_USE_PING_PONG
+#define PPB_MODE PPB_EPN_ONLY
+#define USB_USE_INTERRUPTS
+#else
 #define PPB_MODE PPB_NONE
+#endif
 
 /* Objects from usb_descriptors.c */
 #define USB_DEVICE_DESCRIPTOR this_device_descriptor
@@ -61,7 +90,9 @@
 /* Optional callbacks from usb.c. Leave them commented if you don't want to
    use them. For the prototypes and documentation for each one, see usb.h. */
 
-//#define SET_CONFIGURATION_CALLBACK app_set_configuration_callback
+#ifdef DAP_USE_PING_PONG
+#define SET_CONFIGURATION_CALLBACK app_set_configuration_callback
+#endif
 //#define GET_DEVICE_STATUS_CALLBACK app_get_device_status_callback
 //#define ENDPOINT_HALT_CALLBACK     app_endpoint_halt_callback
 //#define SET_INTERFACE_CALLBACK     app_set_interface_callback
@@ -69,10 +100,16 @@
 //#define OUT_TRANSACTION_CALLBACK   app_out_transaction_callback
 //#define IN_TRANSACTION_COMPLETE_CALLBACK   app_in_transaction_complete_callback
 #define UNKNOWN_SETUP_REQUEST_CALLBACK app_unknown_setup_request_callback
-//#define UNKNOWN_GET_DESCRIPTOR_CALLBACK app_unknown_get_descriptor_callback
+#define UNKNOWN_GET_DESCRIPTOR_CALLBACK usb_application_get_unknown_descriptor
 //#define START_OF_FRAME_CALLBACK    app_start_of_frame_callback
 //#define USB_RESET_CALLBACK         app_usb_reset_callback
 
+/* CMSIS-DAP v2: the BOS descriptor advertises the MS OS 2.0 descriptor set,
+   which is fetched with a vendor request handled in main.c */
+#define MS_OS_20_VENDOR_CODE 0x01
+#define MS_OS_20_DESCRIPTOR_INDEX 0x07
+#define MS_OS_20_DESCRIPTOR_FUNC usb_application_get_ms_os_20_descriptor
+
 /* HID Configuration functions. See usb_hid.h for documentation. */
 #define USB_HID_DESCRIPTOR_FUNC usb_application_get_hid_descriptor
 #define USB_HID_REPORT_DESCRIPTOR_FUNC usb_application_get_hid_report_descriptor
@@ -33,11 +33,18 @@
 struct configuration_1_packet {
 	struct configuration_descriptor  config;
 
+#ifndef DAP_USE_PING_PONG
 	/* HID */
 	struct interface_descriptor      interface;
 	struct hid_descriptor            hid;
 	struct endpoint_descriptor       ep;
 	struct endpoint_descriptor       ep1_out;
+#endif
+
+	/* CMSIS-DAP v2 */
+	struct interface_descriptor      bulk_interface;
+	struct endpoint_descriptor       ep2_out;
+	struct endpoint_descriptor       ep2_in;
 };
 
 /* Device Descriptor */
@@ -45,7 +52,7 @@ const ROMPTR struct device_descriptor this_device_descriptor =
 {
 	sizeof(struct device_descriptor), // bLength
 	DESC_DEVICE, // bDescriptorType
-	0x0200, // 0x0200 = USB 2.0, 0x0110 = USB 1.1
+	0x0210, // 0x0210 = USB 2.1 (so that the BOS descriptor is requested), 0x0200 = USB 2.0, 0x0110 = USB 1.1
 	0x00, /* Device class */
 	0x00, /* Device Subclass. */
 	0x00, /* Protocol. */
@@ -88,13 +95,18 @@ static const ROMPTR struct configuration_1_packet configuration_1 =
 	sizeof(struct configuration_descriptor),
 	DESC_CONFIGURATION,
 	sizeof(configuration_1), // wTotalLength (length of the whole packet)
-	1, // bNumInterfaces (1 for CMSIS-DAP)
+#ifdef DAP_USE_PING_PONG
+	1, // bNumInterfaces (vendor-specific for CMSIS-DAP v2)
+#else
+	2, // bNumInterfaces (HID for CMSIS-DAP v1 and vendor-specific for CMSIS-DAP v2)
+#endif
 	1, // bConfigurationValue
 	0, // iConfiguration (index of string descriptor)
 	0b10000000,
 	100/2,   // 100/2 indicates 100mA
 	},
 
+#ifndef DAP_USE_PING_PONG
 	{
 	// Members from struct interface_descriptor
 	sizeof(struct interface_descriptor), // bLength;
@@ -139,6 +151,108 @@ static const ROMPTR struct configuration_1_packet configuration_1 =
 	EP_1_OUT_LEN, // wMaxPacketSize
 	1, // bInterval in ms.
 	},
+#endif
+
+	{
+	// Members from struct interface_descriptor
+	sizeof(struct interface_descriptor), // bLength;
+	DESC_INTERFACE,
+	DAP_BULK_INTERFACE, // InterfaceNumber
+	0x0, // AlternateSetting
+	0x2, // bNumEndpoints (num besides endpoint 0)
+	0xFF, // bInterfaceClass 3=HID, 0xFF=VendorDefined
+	0x00, // bInterfaceSubclass
+	0x00, // bInterfaceProtocol
+	0x01, // iInterface (CMSIS-DAP v2 requires the interface string to contain "CMSIS-DAP", so reuse the product string)
+	},
+
+	{
+	// Members of the Endpoint Descriptor (bulk OUT)
+	sizeof(struct endpoint_descriptor),
+	DESC_ENDPOINT,
+	DAP_BULK_EP /*| 0x00*/, // 0x00=OUT
+	EP_BULK, // bmAttributes
+	DAP_BULK_LEN, // wMaxPacketSize
+	0, // bInterval (unused for bulk)
+	},
+
+	{
+	// Members of the Endpoint Descriptor (bulk IN)
+	sizeof(struct endpoint_descriptor),
+	DESC_ENDPOINT,
+	DAP_BULK_EP | 0x80, // 0x80=IN
+	EP_BULK, // bmAttributes
+	DAP_BULK_LEN, // wMaxPacketSize
+	0, // bInterval (unused for bulk)
+	},
+};
+
+/* BOS descriptor, advertising the MS OS 2.0 descriptor set below */
+static const ROMPTR uint8_t bos_descriptor[] =
+{
+	0x05,                                           // bLength
+	0x0F,                                           // bDescriptorType: BOS
+	0x21, 0x00,                                     // wTotalLength
+	0x01,                                           // bNumDeviceCaps
+	0x1C,                                           // bLength
+	0x10,                                           // bDescriptorType: device capability
+	0x05,                                           // bDevCapabilityType: platform
+	0x00,                                           // bReserved
+	0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C, // PlatformCapabilityUUID: D8DD60DF-4589-4CC7-9CD2-659D9E648A9F
+	0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F,
+	0x00, 0x00, 0x03, 0x06,                         // dwWindowsVersion: Windows 8.1
+#ifdef DAP_USE_PING_PONG
+	0xA2, 0x00,                                     // wMSOSDescriptorSetTotalLength
+#else
+	0xB2, 0x00,                                     // wMSOSDescriptorSetTotalLength
+#endif
+	MS_OS_20_VENDOR_CODE,                           // bMS_VendorCode
+	0x00,                                           // bAltEnumCode
+};
+
+/*
+MS OS 2.0 descriptor set, binding WinUSB to the CMSIS-DAP v2 interface so that no .inf file is needed on Windows; 
+the subset headers are only needed when the device is composite
+*/
+static const ROMPTR uint8_t ms_os_20_descriptor_set[] =
+{
+	0x0A, 0x00,                                     // wLength
+	0x00, 0x00,                                     // wDescriptorType: MS OS 2.0 descriptor set header
+	0x00, 0x00, 0x03, 0x06,                         // dwWindowsVersion: Windows 8.1
+#ifdef DAP_USE_PING_PONG
+	0xA2, 0x00,                                     // wTotalLength
+#else
+	0xB2, 0x00,                                     // wTotalLength
+	0x08, 0x00,                                     // wLength
+	0x01, 0x00,                                     // wDescriptorType: configuration subset header
+	0x00,                                           // bConfigurationValue
+	0x00,                                           // bReserved
+	0xA8, 0x00,                                     // wTotalLength
+	0x08, 0x00,                                     // wLength
+	0x02, 0x00,                                     // wDescriptorType: function subset header
+	0x01,                                           // bFirstInterface
+	0x00,                                           // bReserved
+	0xA0, 0x00,                                     // wSubsetLength
+#endif
+	0x14, 0x00,                                     // wLength
+	0x03, 0x00,                                     // wDescriptorType: compatible ID
+	'W', 'I', 'N', 'U', 'S', 'B', 0x00, 0x00,       // CompatibleID
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // SubCompatibleID
+	0x84, 0x00,                                     // wLength
+	0x04, 0x00,                                     // wDescriptorType: registry property
+	0x07, 0x00,                                     // wPropertyDataType: REG_MULTI_SZ
+	0x2A, 0x00,                                     // wPropertyNameLength
+	// PropertyName: "DeviceInterfaceGUIDs"
+	'D', 0x00, 'e', 0x00, 'v', 0x00, 'i', 0x00, 'c', 0x00, 'e', 0x00, 'I', 0x00, 'n', 0x00,
+	't', 0x00, 'e', 0x00, 'r', 0x00, 'f', 0x00, 'a', 0x00, 'c', 0x00, 'e', 0x00, 'G', 0x00,
+	'U', 0x00, 'I', 0x00, 'D', 0x00, 's', 0x00, 0x00, 0x00,
+	0x50, 0x00,                                     // wPropertyDataLength
+	// PropertyData: "{CDB3B5AD-293B-4663-AA36-1AAE46463776}" (the CMSIS-DAP v2 interface GUID)
+	'{', 0x00, 'C', 0x00, 'D', 0x00, 'B', 0x00, '3', 0x00, 'B', 0x00, '5', 0x00, 'A', 0x00,
+	'D', 0x00, '-', 0x00, '2', 0x00, '9', 0x00, '3', 0x00, 'B', 0x00, '-', 0x00, '4', 0x00,
+	'6', 0x00, '6', 0x00, '3', 0x00, '-', 0x00, 'A', 0x00, 'A', 0x00, '3', 0x00, '6', 0x00,
+	'-', 0x00, '1', 0x00, 'A', 0x00, 'A', 0x00, 'E', 0x00, '4', 0x00, '6', 0x00, '4', 0x00,
+	'6', 0x00, '3', 0x00, '7', 0x00, '7', 0x00, '6', 0x00, '}', 0x00, 0x00, 0x00, 0x00, 0x00,
 };
 
 /* String Descriptors */
@@ -197,11 +311,16 @@ STATIC_SIZE_CHECK_EQUAL(sizeof(USB_DEVICE_DESCRIPTOR), 18);
 /* HID Descriptor Function */
 int16_t usb_application_get_hid_descriptor(uint8_t interface, const void **ptr)
 {
+#ifdef DAP_USE_PING_PONG
+	/* there is no HID interface in this variant */
+	return -1;
+#else
 	/* Only one interface in this demo. The two-step assignment avoids an
 	 * incorrect error in XC8 on PIC16. */
 	const void *p = &configuration_1.hid;
 	*ptr = p;
 	return sizeof(configuration_1.hid);
+#endif
 }
 
 /** HID Report Descriptor Function */
@@ -210,3 +329,20 @@ int16_t usb_application_get_hid_report_descriptor(uint8_t interface, const void
 	*ptr = custom_report_descriptor;
 	return sizeof(custom_report_descriptor);
 }
+
+/* Unknown GET_DESCRIPTOR Function; the only one supported is the BOS descriptor */
+int16_t usb_application_get_unknown_descriptor(const struct setup_packet *pkt, const void **ptr)
+{
+	if ((pkt->wValue >> 8) != 0x0F /* BOS */)
+		return -1;
+
+	*ptr = bos_descriptor;
+	return sizeof(bos_descriptor);
+}
+
+/* MS OS 2.0 Descriptor Set Function */
+int16_t usb_application_get_ms_os_20_descriptor(const void **ptr)
+{
+	*ptr = ms_os_20_descriptor_set;
+	return sizeof(ms_os_20_descriptor_set);
+}
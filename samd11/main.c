@@ -37,14 +37,70 @@
 #include "dm.h"
 
 /*- Definitions -------------------------------------------------------------*/
-#define APP_EP_SEND    1
-#define APP_EP_RECV    2
+#define APP_EP_SEND       1
+#define APP_EP_RECV       2
+#define APP_EP_BULK_SEND  3
+#define APP_EP_BULK_RECV  4
+
+// the DAP endpoints are dual bank, so up to this many transfers can be handed to each at once
+#define APP_EP_BANKS      2
 
 extern char usb_serial_number[16];
 
+/*- Types -------------------------------------------------------------------*/
+// each DAP transport (Vendor HID and CMSIS-DAP v2 bulk) has its own queue;
+// the indices are free-running; dap_index is advanced by app_task() in the main loop,
+// and all the others from within the USB ISR;
+// slots between tx_index and dap_index hold responses awaiting the host, of which
+// those up to send_index have been handed to the IN endpoint, slots between dap_index
+// and rx_index hold commands awaiting execution, and slots between rx_index and
+// recv_index have been handed to the OUT endpoint for the next commands;
+// app_reset() rewinds them all and bumps generation, so that app_task() knows to
+// discard a command it was executing at the time; a slot's length is that of the
+// command received into it until app_task() replaces it with that of the response
+typedef struct
+{
+  uint8_t buffer[DAP_PACKET_COUNT][DAP_PACKET_SIZE] __attribute__ ((aligned (4)));
+  uint8_t response[DAP_PACKET_COUNT][DAP_PACKET_SIZE] __attribute__ ((aligned (4)));
+  int length[DAP_PACKET_COUNT];
+  volatile uint8_t rx_index;
+  volatile uint8_t tx_index;
+  volatile uint8_t send_index;
+  volatile uint8_t recv_index;
+  volatile uint8_t dap_index;
+  volatile uint8_t generation;
+  // HID reports are always full-size, whereas bulk responses carry only their actual length
+  bool bulk;
+  int ep_send;
+  int ep_recv;
+  void (*send_callback)(void);
+  void (*recv_callback)(int size);
+} app_queue_t;
+
+/*- Prototypes --------------------------------------------------------------*/
+static void app_hid_send_callback(void);
+static void app_hid_recv_callback(int size);
+static void app_bulk_send_callback(void);
+static void app_bulk_recv_callback(int size);
+
 /*- Variables ---------------------------------------------------------------*/
-static uint8_t app_request_buffer[DAP_PACKET_SIZE]  __attribute__ ((aligned (4)));
-static uint8_t app_response_buffer[DAP_PACKET_SIZE] __attribute__ ((aligned (4)));
+static app_queue_t app_hid_queue =
+{
+  .bulk = false,
+  .ep_send = APP_EP_SEND,
+  .ep_recv = APP_EP_RECV,
+  .send_callback = app_hid_send_callback,
+  .recv_callback = app_hid_recv_callback,
+};
+
+static app_queue_t app_bulk_queue =
+{
+  .bulk = true,
+  .ep_send = APP_EP_BULK_SEND,
+  .ep_recv = APP_EP_BULK_RECV,
+  .send_callback = app_bulk_send_callback,
+  .recv_callback = app_bulk_recv_callback,
+};
 
 /*- Implementations ---------------------------------------------------------*/
 
@@ -92,25 +148,121 @@ static void sys_init(void)
 }
 
 //-----------------------------------------------------------------------------
-void usb_send_callback(void)
+static void app_send(app_queue_t *queue)
 {
+  // hand finished responses to the IN endpoint, so that one is ready to go as soon as the host has collected another
+  while (queue->send_index != queue->dap_index && (uint8_t)(queue->send_index - queue->tx_index) < APP_EP_BANKS)
+  {
+    int index = queue->send_index++ % DAP_PACKET_COUNT;
+
+    usb_send(queue->ep_send, queue->response[index], queue->length[index], queue->send_callback);
+  }
+}
+
+//-----------------------------------------------------------------------------
+static void app_recv(app_queue_t *queue)
+{
+  // hand free slots to the OUT endpoint, so that the next command is accepted whilst this one clocks SWD
+  while ((uint8_t)(queue->recv_index - queue->rx_index) < APP_EP_BANKS && (uint8_t)(queue->recv_index - queue->tx_index) < DAP_PACKET_COUNT)
+  {
+    int index = queue->recv_index++ % DAP_PACKET_COUNT;
+
+    usb_recv(queue->ep_recv, queue->buffer[index], DAP_PACKET_SIZE, queue->recv_callback);
+  }
 }
 
 //-----------------------------------------------------------------------------
-void usb_recv_callback(void)
+static void app_send_callback(app_queue_t *queue)
 {
-  memcpy(app_response_buffer, app_request_buffer, DAP_PACKET_SIZE);
-  dap_handler(app_response_buffer);
+  queue->tx_index++;
+
+  // a slot has been freed; if reception was stalled for want of one, resume it
+  app_send(queue);
+  app_recv(queue);
+}
+
+//-----------------------------------------------------------------------------
+static void app_recv_callback(app_queue_t *queue, int size)
+{
+  // the command is left in its slot for app_task(); the OUT endpoint is re-armed straight away if there is room
+  queue->length[queue->rx_index % DAP_PACKET_COUNT] = size;
+  queue->rx_index++;
+
+  app_recv(queue);
+}
+
+//-----------------------------------------------------------------------------
+static void app_task(app_queue_t *queue)
+{
+  uint8_t generation = queue->generation;
+  int index = queue->dap_index % DAP_PACKET_COUNT;
+  int length;
+
+  if (queue->dap_index == queue->rx_index)
+    return;
+
+  // the USB DMA delivers the command straight into its slot, and fetches the response straight from the slot's other half
+  length = dap_handler(queue->buffer[index], queue->length[index], queue->response[index], DAP_PACKET_SIZE);
 
-  usb_send(APP_EP_SEND, app_response_buffer, sizeof(app_response_buffer), usb_send_callback);
+  // app_send() is otherwise only called from the USB ISR
+  __disable_irq();
 
-  usb_recv(APP_EP_RECV, app_request_buffer, sizeof(app_request_buffer), usb_recv_callback);
+  if (generation == queue->generation)
+  {
+    queue->length[index] = queue->bulk ? length : DAP_PACKET_SIZE;
+    queue->dap_index++;
+
+    app_send(queue);
+  }
+
+  __enable_irq();
+}
+
+//-----------------------------------------------------------------------------
+static void app_reset(app_queue_t *queue)
+{
+  queue->rx_index = 0;
+  queue->tx_index = 0;
+  queue->send_index = 0;
+  queue->recv_index = 0;
+  queue->dap_index = 0;
+  queue->generation++;
+
+  usb_configure_dual_bank(queue->ep_send, USB_IN_ENDPOINT);
+  usb_configure_dual_bank(queue->ep_recv, USB_OUT_ENDPOINT);
+
+  app_recv(queue);
+}
+
+//-----------------------------------------------------------------------------
+static void app_hid_send_callback(void)
+{
+  app_send_callback(&app_hid_queue);
+}
+
+//-----------------------------------------------------------------------------
+static void app_hid_recv_callback(int size)
+{
+  app_recv_callback(&app_hid_queue, size);
+}
+
+//-----------------------------------------------------------------------------
+static void app_bulk_send_callback(void)
+{
+  app_send_callback(&app_bulk_queue);
+}
+
+//-----------------------------------------------------------------------------
+static void app_bulk_recv_callback(int size)
+{
+  app_recv_callback(&app_bulk_queue, size);
 }
 
 //-----------------------------------------------------------------------------
 void usb_configuration_callback(int config)
 {
-  usb_recv(APP_EP_RECV, app_request_buffer, sizeof(app_request_buffer), usb_recv_callback);
+  app_reset(&app_hid_queue);
+  app_reset(&app_bulk_queue);
 
   (void)config;
 }
@@ -121,7 +273,12 @@ int main(void)
   sys_init();
   usb_init();
 
-  while (1);
+  // USB is serviced from its ISR; the main loop only executes the queued DAP commands
+  while (1)
+  {
+    app_task(&app_hid_queue);
+    app_task(&app_bulk_queue);
+  }
 
   return 0;
 }
@@ -2,13 +2,38 @@
 #define __SWDIO_BSP_H
 
 #include <samd11.h>
+#include "dm_bsp.h" /* for DAP_USE_SPI_ENGINE */
 
 /*
 this must be customized to suit the end application
 */
 
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+SERCOM0 (function C) shifts the SWD request and data phases; see swdio_spi.c
+SWCLK is on SCK/PAD[1] (PA15) and SWDIO on MOSI/PAD[0] (PA14), with MISO/PAD[2] (PA04) also wired to SWDIO;
+the macros below bit-bang these same pins for everything else
+*/
+
+#define CLK_PIN   15
+#define DATA_PIN  14
+#define MISO_PIN  4
+
+#define SWD_SERCOM           SERCOM0
+#define SWD_SERCOM_PMUX      2 /* function C */
+#define SWD_SERCOM_DOPO      0 /* DO on PAD[0], SCK on PAD[1] */
+#define SWD_SERCOM_DIPO      2 /* DI on PAD[2] */
+#define SWD_SERCOM_APBCMASK  PM_APBCMASK_SERCOM0
+#define SWD_SERCOM_GCLK_ID   GCLK_CLKCTRL_ID_SERCOM0_CORE
+
+#else
+
 #define CLK_PIN   8
 #define DATA_PIN  5
+
+#endif
+
 #define RESET_PIN 9
 #define PORTGROUP 0
 
@@ -29,10 +54,28 @@ this must be customized to suit the end application
 #define RESET_ENABLE { PORT->Group[PORTGROUP].DIRSET.reg = (1 << RESET_PIN); PORT->Group[PORTGROUP].PINCFG[RESET_PIN].reg |= PORT_PINCFG_INEN; }
 #define RESET_HIZ    { PORT->Group[PORTGROUP].DIRCLR.reg = (1 << RESET_PIN); PORT->Group[PORTGROUP].PINCFG[RESET_PIN].reg |= PORT_PINCFG_INEN; }
 
+#ifdef DAP_USE_SPI_ENGINE
+#define SWDIO_INIT  { swd_spi_init(); }
+#else
 #define SWDIO_INIT  { }
+#endif
 
 #define DATA_READ   (PORT->Group[PORTGROUP].IN.reg & (1UL << DATA_PIN))
 #define CLK_READ    (PORT->Group[PORTGROUP].IN.reg & (1UL << CLK_PIN))
 #define RESET_READ  (PORT->Group[PORTGROUP].IN.reg & (1UL << RESET_PIN))
 
+/* SysTick, otherwise unused, counts down from the 48MHz core clock and times the vendor wait command */
+
+#define TIMER_INIT         { SysTick->LOAD = 0xFFFFFFUL; SysTick->VAL = 0; SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk; }
+#define TIMER_READ         (~SysTick->VAL)
+#define TIMER_MASK         0xFFFFFFUL
+#define TIMER_TICKS_PER_US 48
+
+#ifdef DAP_USE_SPI_ENGINE
+#include <stdint.h>
+
+void swd_spi_init(void);
+uint8_t swd_transaction(uint8_t request, uint32_t *data);
+#endif
+
 #endif /* __SWDIO_BSP_H */
@@ -0,0 +1,208 @@
+/*
+    CMSIS-DAP implementation for SAMD11
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <stdint.h>
+#include "swdio_bsp.h"
+
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+a SERCOM in SPI master mode takes over from bit-banging for the parts of a SWD transaction that are a whole
+number of characters: the 8-bit request and the 32-bit data phase (as four 8-bit characters); the turnaround,
+ACK and parity cycles in between are still bit-banged on the same pins, and dm.c adds any idle cycles
+
+SCK and MOSI are only muxed to the SERCOM (PINCFG.PMUXEN) for the duration of each burst of characters;
+otherwise the pins fall back to the PORT, so that dm.c can continue to bit-bang DAP_SWJ_Sequence etc. as before
+
+SWCLK idles low throughout (CPOL=0), same as the bit-banged code.  Host data is presented ahead of each
+rising edge (CPHA=0), which is when the target samples it.  Target data changes after each rising edge,
+so it is sampled on the falling edge instead (CPHA=1).  As SPI then clocks a rising edge before sampling,
+the last ACK bit is read without the rising edge that normally follows it; the read data phase supplies it.
+*/
+
+#ifndef SWD_SPI_BAUD
+#define SWD_SPI_BAUD  3 /* 48MHz / (2 * (BAUD + 1)): 6MHz SWCLK */
+#endif
+
+#define SWD_SPI_CTRLA (SERCOM_SPI_CTRLA_MODE_SPI_MASTER | SERCOM_SPI_CTRLA_DORD | \
+                       SERCOM_SPI_CTRLA_DOPO(SWD_SERCOM_DOPO) | SERCOM_SPI_CTRLA_DIPO(SWD_SERCOM_DIPO))
+
+#define CHSIZE_8BIT   0
+
+#define PIN_PMUX(pin) { if ((pin) & 1) PORT->Group[PORTGROUP].PMUX[(pin) >> 1].bit.PMUXO = SWD_SERCOM_PMUX; else PORT->Group[PORTGROUP].PMUX[(pin) >> 1].bit.PMUXE = SWD_SERCOM_PMUX; }
+#define PIN_TO_SERCOM(pin) { PORT->Group[PORTGROUP].PINCFG[pin].reg |= PORT_PINCFG_PMUXEN; }
+#define PIN_TO_PORT(pin)   { PORT->Group[PORTGROUP].PINCFG[pin].reg &= ~PORT_PINCFG_PMUXEN; }
+
+static inline uint32_t spi_parity(uint32_t value)
+{
+  value ^= value >> 16;
+  value ^= value >> 8;
+  value ^= value >> 4;
+  return (0x6996 >> (value & 0x0F)) & 0x01;
+}
+
+/* hand SCK (and optionally MOSI) to the SERCOM; CPHA and CHSIZE are enable-protected, so set them first */
+
+static void spi_begin(uint32_t cpha, uint32_t chsize, int drive_data)
+{
+  SWD_SERCOM->SPI.CTRLA.reg = SWD_SPI_CTRLA | cpha;
+  SWD_SERCOM->SPI.CTRLB.reg = SERCOM_SPI_CTRLB_RXEN | SERCOM_SPI_CTRLB_CHSIZE(chsize);
+  SWD_SERCOM->SPI.CTRLA.reg = SWD_SPI_CTRLA | cpha | SERCOM_SPI_CTRLA_ENABLE;
+  while (SWD_SERCOM->SPI.SYNCBUSY.reg)
+    ;
+
+  PIN_TO_SERCOM(CLK_PIN);
+  if (drive_data)
+    PIN_TO_SERCOM(DATA_PIN);
+}
+
+static uint32_t spi_frame(uint32_t data)
+{
+  SWD_SERCOM->SPI.DATA.reg = data;
+  while (!(SWD_SERCOM->SPI.INTFLAG.reg & SERCOM_SPI_INTFLAG_RXC));
+  return SWD_SERCOM->SPI.DATA.reg;
+}
+
+/*
+wait for the SERCOM to finish, then return SCK (left low, same as SPI idle) and MOSI to the PORT;
+MOSI takes on whatever DATA_xxx state the caller has already set up
+*/
+
+static void spi_end(void)
+{
+  while (!(SWD_SERCOM->SPI.INTFLAG.reg & SERCOM_SPI_INTFLAG_TXC))
+    ;
+
+  CLK_LOW;
+  CLK_ENABLE;
+  PIN_TO_PORT(CLK_PIN);
+  PIN_TO_PORT(DATA_PIN);
+
+  SWD_SERCOM->SPI.CTRLA.reg = SWD_SPI_CTRLA;
+  while (SWD_SERCOM->SPI.SYNCBUSY.reg);
+}
+
+static void clock_cycle(void)
+{
+  CLK_HIGH;
+  CLK_LOW;
+}
+
+void swd_spi_init(void)
+{
+  PM->APBCMASK.reg |= SWD_SERCOM_APBCMASK;
+  GCLK->CLKCTRL.reg = SWD_SERCOM_GCLK_ID | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_CLKEN;
+
+  SWD_SERCOM->SPI.CTRLA.reg = SERCOM_SPI_CTRLA_SWRST;
+  while (SWD_SERCOM->SPI.SYNCBUSY.reg);
+
+  SWD_SERCOM->SPI.CTRLA.reg = SWD_SPI_CTRLA;
+  SWD_SERCOM->SPI.BAUD.reg = SWD_SPI_BAUD;
+
+  /* the function selection is permanent; PMUXEN alone decides who owns the pin */
+  PIN_PMUX(CLK_PIN);
+  PIN_PMUX(DATA_PIN);
+  PIN_PMUX(MISO_PIN);
+
+  /* MISO is only ever an input, so it can stay with the SERCOM permanently */
+  PORT->Group[PORTGROUP].DIRCLR.reg = (1 << MISO_PIN);
+  PORT->Group[PORTGROUP].PINCFG[MISO_PIN].reg |= PORT_PINCFG_INEN;
+  PIN_TO_SERCOM(MISO_PIN);
+}
+
+uint8_t swd_transaction(uint8_t request, uint32_t *data)
+{
+  uint32_t ack, value;
+
+  /* request; SWDIO is released as it comes back from the SERCOM, for the turnaround */
+  spi_begin(0, CHSIZE_8BIT, 1);
+  spi_frame(request);
+  DATA_HIZ;
+  spi_end();
+
+  /* turnaround, then ACK; the final rising edge is deferred (see above) */
+  ack = 0;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x01;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x02;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x04;
+
+  if ( (1 /* OK */ == ack) && (request & 0x04) )
+  {
+    /* read: the first SPI rising edge is the one deferred above */
+    spi_begin(SERCOM_SPI_CTRLA_CPHA, CHSIZE_8BIT, 0);
+    value  = spi_frame(0xFF) << 0;
+    value |= spi_frame(0xFF) << 8;
+    value |= spi_frame(0xFF) << 16;
+    value |= spi_frame(0xFF) << 24;
+    spi_end();
+    *data = value;
+
+    /* parity bit, then turnaround */
+    CLK_HIGH;
+    CLK_LOW;
+    asm("nop");
+    if ( (DATA_READ ? 1 : 0) != spi_parity(value) )
+      ack |= 0x08;
+    clock_cycle();
+    clock_cycle();
+
+    DATA_LOW;
+    DATA_ENABLE;
+  }
+  else
+  {
+    clock_cycle(); /* rising edge deferred from the ACK */
+
+    if (2 /* WAIT */ == ack)
+      clock_cycle(); /* turnaround cycle (Figure 2-4 DDI 0316D) */
+
+    if (1 /* OK */ != ack)
+      return ack;
+
+    /* write: turnaround cycle, data, then parity bit */
+    clock_cycle();
+    value = *data;
+    DATA_LOW;
+    DATA_ENABLE;
+    spi_begin(0, CHSIZE_8BIT, 1);
+    spi_frame((value >> 0) & 0xFF);
+    spi_frame((value >> 8) & 0xFF);
+    spi_frame((value >> 16) & 0xFF);
+    spi_frame((value >> 24) & 0xFF);
+    spi_end();
+    if (spi_parity(value))
+    {
+      DATA_HIGH;
+    }
+    clock_cycle();
+  }
+
+  /* SWDIO is now the PORT output that shift_bits_out() expects */
+  return ack;
+}
+
+#endif /* DAP_USE_SPI_ENGINE */
@@ -74,8 +74,20 @@ typedef union
   };
 } udc_mem_t;
 
+// in dual bank mode, both banks of an endpoint serve its one direction in turn;
+// next is the bank that udc_send()/udc_recv() will hand to the hardware and done the bank
+// whose transfer is to complete first
+typedef struct
+{
+  bool         enabled;
+  int          dir;
+  int          next;
+  int          done;
+} udc_dual_bank_t;
+
 /*- Variables ---------------------------------------------------------------*/
 static udc_mem_t udc_mem[USB_EPT_NUM];
+static udc_dual_bank_t udc_dual_bank[USB_EPT_NUM];
 static uint32_t udc_ctrl_in_buf[16];
 static uint32_t udc_ctrl_out_buf[16];
 
@@ -136,6 +148,12 @@ void udc_detach(void)
 //-----------------------------------------------------------------------------
 void udc_reset_endpoint(int ep, int dir)
 {
+  if (udc_dual_bank[ep].enabled)
+  {
+    udc_dual_bank[ep].enabled = false;
+    USB->DEVICE.DeviceEndpoint[ep].EPCFG.reg = 0;
+  }
+
   if (USB_IN_ENDPOINT == dir)
     USB->DEVICE.DeviceEndpoint[ep].EPCFG.bit.EPTYPE1 = USB_DEVICE_EPCFG_EPTYPE_DISABLED;
   else
@@ -200,9 +218,39 @@ void udc_configure_endpoint(usb_endpoint_descriptor_t *desc)
   }
 }
 
+//-----------------------------------------------------------------------------
+void udc_configure_dual_bank(int ep, int dir)
+{
+  // the bank that normally serves the opposite direction is turned over to this one
+  if (USB_IN_ENDPOINT == dir)
+  {
+    USB->DEVICE.DeviceEndpoint[ep].EPCFG.bit.EPTYPE0 = USB_DEVICE_EPCFG_EPTYPE_DUAL_BANK;
+    USB->DEVICE.DeviceEndpoint[ep].EPINTENSET.bit.TRCPT0 = 1;
+    USB->DEVICE.DeviceEndpoint[ep].EPSTATUSCLR.bit.BK0RDY = 1;
+    udc_mem[ep].bank[0].PCKSIZE.bit.SIZE = udc_mem[ep].in.PCKSIZE.bit.SIZE;
+  }
+  else
+  {
+    USB->DEVICE.DeviceEndpoint[ep].EPCFG.bit.EPTYPE1 = USB_DEVICE_EPCFG_EPTYPE_DUAL_BANK;
+    USB->DEVICE.DeviceEndpoint[ep].EPINTENSET.bit.TRCPT1 = 1;
+    USB->DEVICE.DeviceEndpoint[ep].EPSTATUSSET.bit.BK1RDY = 1;
+    udc_mem[ep].bank[1].PCKSIZE.bit.SIZE = udc_mem[ep].out.PCKSIZE.bit.SIZE;
+  }
+
+  USB->DEVICE.DeviceEndpoint[ep].EPSTATUSCLR.bit.CURBK = 1;
+
+  udc_dual_bank[ep].enabled = true;
+  udc_dual_bank[ep].dir = dir;
+  udc_dual_bank[ep].next = 0;
+  udc_dual_bank[ep].done = 0;
+}
+
 //-----------------------------------------------------------------------------
 bool udc_endpoint_configured(int ep, int dir)
 {
+  if (udc_dual_bank[ep].enabled)
+    return (dir == udc_dual_bank[ep].dir);
+
   if (USB_IN_ENDPOINT == dir)
     return (USB_DEVICE_EPCFG_EPTYPE_DISABLED != USB->DEVICE.DeviceEndpoint[ep].EPCFG.bit.EPTYPE1);
   else
@@ -267,6 +315,20 @@ void udc_set_address(int address)
 //-----------------------------------------------------------------------------
 void udc_send(int ep, uint8_t *data, int size)
 {
+  if (udc_dual_bank[ep].enabled)
+  {
+    int bank = udc_dual_bank[ep].next;
+
+    udc_dual_bank[ep].next ^= 1;
+
+    udc_mem[ep].bank[bank].ADDR.reg = (uint32_t)data;
+    udc_mem[ep].bank[bank].PCKSIZE.bit.BYTE_COUNT = size;
+    udc_mem[ep].bank[bank].PCKSIZE.bit.MULTI_PACKET_SIZE = 0;
+
+    USB->DEVICE.DeviceEndpoint[ep].EPSTATUSSET.reg = bank ? USB_DEVICE_EPSTATUSSET_BK1RDY : USB_DEVICE_EPSTATUSSET_BK0RDY;
+    return;
+  }
+
   udc_mem[ep].in.ADDR.reg = (uint32_t)data;
   udc_mem[ep].in.PCKSIZE.bit.BYTE_COUNT = size;
   udc_mem[ep].in.PCKSIZE.bit.MULTI_PACKET_SIZE = 0;
@@ -277,6 +339,20 @@ void udc_send(int ep, uint8_t *data, int size)
 //-----------------------------------------------------------------------------
 void udc_recv(int ep, uint8_t *data, int size)
 {
+  if (udc_dual_bank[ep].enabled)
+  {
+    int bank = udc_dual_bank[ep].next;
+
+    udc_dual_bank[ep].next ^= 1;
+
+    udc_mem[ep].bank[bank].ADDR.reg = (uint32_t)data;
+    udc_mem[ep].bank[bank].PCKSIZE.bit.MULTI_PACKET_SIZE = size;
+    udc_mem[ep].bank[bank].PCKSIZE.bit.BYTE_COUNT = 0;
+
+    USB->DEVICE.DeviceEndpoint[ep].EPSTATUSCLR.reg = bank ? USB_DEVICE_EPSTATUSCLR_BK1RDY : USB_DEVICE_EPSTATUSCLR_BK0RDY;
+    return;
+  }
+
   udc_mem[ep].out.ADDR.reg = (uint32_t)data;
   udc_mem[ep].out.PCKSIZE.bit.MULTI_PACKET_SIZE = size;
   udc_mem[ep].out.PCKSIZE.bit.BYTE_COUNT = 0;
@@ -327,7 +403,7 @@ void udc_control_send(uint8_t *data, int size)
 //-----------------------------------------------------------------------------
 void USB_Handler(void)
 {
-  int epint, flags;
+  int epint, flags, size;
 
   if (USB->DEVICE.INTFLAG.bit.EORST)
   {
@@ -379,12 +455,35 @@ void USB_Handler(void)
 
     flags = USB->DEVICE.DeviceEndpoint[i].EPINTFLAG.reg;
 
+    if (udc_dual_bank[i].enabled)
+    {
+      // the banks complete alternately; take them in that order should both be pending
+      for (int n = 0; n < 2; n++)
+      {
+        int done = udc_dual_bank[i].done ? USB_DEVICE_EPINTFLAG_TRCPT1 : USB_DEVICE_EPINTFLAG_TRCPT0;
+
+        if (0 == (flags & done))
+          break;
+
+        USB->DEVICE.DeviceEndpoint[i].EPINTFLAG.reg = done;
+        size = udc_mem[i].bank[udc_dual_bank[i].done].PCKSIZE.bit.BYTE_COUNT;
+        udc_dual_bank[i].done ^= 1;
+
+        if (USB_IN_ENDPOINT == udc_dual_bank[i].dir)
+          udc_send_callback(i);
+        else
+          udc_recv_callback(i, size);
+      }
+
+      continue;
+    }
+
     if (flags & USB_DEVICE_EPINTFLAG_TRCPT0)
     {
       USB->DEVICE.DeviceEndpoint[i].EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT0;
       USB->DEVICE.DeviceEndpoint[i].EPSTATUSSET.bit.BK0RDY = 1;
 
-      udc_recv_callback(i);
+      udc_recv_callback(i, udc_mem[i].out.PCKSIZE.bit.BYTE_COUNT);
     }
 
     if (flags & USB_DEVICE_EPINTFLAG_TRCPT1)
@@ -43,6 +43,7 @@ void udc_attach(void);
 void udc_detach(void);
 void udc_reset_endpoint(int ep, int dir);
 void udc_configure_endpoint(usb_endpoint_descriptor_t *ep_desc);
+void udc_configure_dual_bank(int ep, int dir);
 bool udc_endpoint_configured(int ep, int dir);
 int udc_endpoint_get_status(int ep, int dir);
 void udc_endpoint_set_feature(int ep, int dir);
@@ -55,7 +56,7 @@ void udc_control_stall(void);
 void udc_control_send(uint8_t *data, int size);
 
 void udc_send_callback(int ep);
-void udc_recv_callback(int ep);
+void udc_recv_callback(int ep, int size);
 
 #endif // _UDC_H_
 
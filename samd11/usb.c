@@ -41,13 +41,8 @@
 /*- Types -------------------------------------------------------------------*/
 typedef struct
 {
-  void         (*callback)(void);
-} usb_endpoint_bank_t;
-
-typedef struct
-{
-  usb_endpoint_bank_t out;
-  usb_endpoint_bank_t in;
+  void         (*recv_callback)(int size);
+  void         (*send_callback)(void);
 } usb_endpoint_t;
 
 /*- Variables ---------------------------------------------------------------*/
@@ -67,19 +62,25 @@ void usb_init(void)
 //-----------------------------------------------------------------------------
 void usb_send(int ep, uint8_t *data, int size, void (*callback)(void))
 {
-  usb_endpoints[ep].in.callback = callback;
+  usb_endpoints[ep].send_callback = callback;
 
   udc_send(ep, data, size);
 }
 
 //-----------------------------------------------------------------------------
-void usb_recv(int ep, uint8_t *data, int size, void (*callback)(void))
+void usb_recv(int ep, uint8_t *data, int size, void (*callback)(int size))
 {
-  usb_endpoints[ep].out.callback = callback;
+  usb_endpoints[ep].recv_callback = callback;
 
   udc_recv(ep, data, size);
 }
 
+//-----------------------------------------------------------------------------
+void usb_configure_dual_bank(int ep, int dir)
+{
+  udc_configure_dual_bank(ep, dir);
+}
+
 //-----------------------------------------------------------------------------
 void usb_handle_standard_request(usb_request_t *request)
 {
@@ -133,6 +134,12 @@ void usb_handle_standard_request(usb_request_t *request)
           udc_control_stall();
         }
       }
+      else if (USB_BINARY_OBJECT_STORE_DESCRIPTOR == type)
+      {
+        length = LIMIT(length, sizeof(usb_bos_descriptor));
+
+        udc_control_send((uint8_t *)usb_bos_descriptor, length);
+      }
       else
         udc_control_stall();
     }  break;
@@ -259,6 +266,22 @@ void usb_handle_standard_request(usb_request_t *request)
       udc_control_send((uint8_t *)usb_hid_report_descriptor, length);
     } break;
 
+    case USB_CMD(IN, DEVICE, VENDOR, MS_OS_20_VENDOR_CODE):
+    {
+      uint16_t length = request->wLength;
+
+      if (USB_MS_OS_20_DESCRIPTOR_INDEX == request->wIndex)
+      {
+        length = LIMIT(length, sizeof(usb_ms_os_20_descriptor_set));
+
+        udc_control_send((uint8_t *)usb_ms_os_20_descriptor_set, length);
+      }
+      else
+      {
+        udc_control_stall();
+      }
+    } break;
+
     default:
     {
       udc_control_stall();
@@ -267,16 +290,16 @@ void usb_handle_standard_request(usb_request_t *request)
 }
 
 //-----------------------------------------------------------------------------
-void udc_recv_callback(int ep)
+void udc_recv_callback(int ep, int size)
 {
-  if (usb_endpoints[ep].out.callback)
-    usb_endpoints[ep].out.callback();
+  if (usb_endpoints[ep].recv_callback)
+    usb_endpoints[ep].recv_callback(size);
 }
 
 //-----------------------------------------------------------------------------
 void udc_send_callback(int ep)
 {
-  if (usb_endpoints[ep].in.callback)
-    usb_endpoints[ep].in.callback();
+  if (usb_endpoints[ep].send_callback)
+    usb_endpoints[ep].send_callback();
 }
 
@@ -199,7 +199,8 @@ typedef struct PACK
 /*- Prototypes --------------------------------------------------------------*/
 void usb_init(void);
 void usb_send(int ep, uint8_t *data, int size, void (*callback)(void));
-void usb_recv(int ep, uint8_t *data, int size, void (*callback)(void));
+void usb_recv(int ep, uint8_t *data, int size, void (*callback)(int size));
+void usb_configure_dual_bank(int ep, int dir);
 void usb_handle_standard_request(usb_request_t *request);
 
 void usb_configuration_callback(int config);
@@ -41,6 +41,12 @@ enum
   USB_HID_PHYSICAL_DESCRIPTOR = 0x23,
 };
 
+enum
+{
+  USB_MS_OS_20_VENDOR_CODE      = 0x01,
+  USB_MS_OS_20_DESCRIPTOR_INDEX = 0x07,
+};
+
 enum
 {
   USB_STR_ZERO,
@@ -68,12 +74,17 @@ typedef struct PACK
   usb_hid_descriptor_t            hid;
   usb_endpoint_descriptor_t       ep_in;
   usb_endpoint_descriptor_t       ep_out;
+  usb_interface_descriptor_t      bulk_interface;
+  usb_endpoint_descriptor_t       bulk_ep_out;
+  usb_endpoint_descriptor_t       bulk_ep_in;
 } usb_configuration_hierarchy_t;
 
 //-----------------------------------------------------------------------------
 extern const usb_device_descriptor_t usb_device_descriptor;
 extern const usb_configuration_hierarchy_t usb_configuration_hierarchy;
 extern const uint8_t usb_hid_report_descriptor[33];
+extern const uint8_t usb_bos_descriptor[33];
+extern const uint8_t usb_ms_os_20_descriptor_set[178];
 extern const usb_string_descriptor_zero_t usb_string_descriptor_zero;
 extern const char *const usb_strings[];
 extern uint8_t usb_string_descriptor_buffer[64];
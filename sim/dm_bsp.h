@@ -0,0 +1,23 @@
+#ifndef __DM_BSP_H
+#define __DM_BSP_H
+
+/* the Makefile builds several variants of dm.c, passing DAP_USE_WORD_SHIFT etc. on the command line */
+
+#define DAP_PACKET_COUNT  4
+
+#ifndef DAP_PACKET_SIZE
+#define DAP_PACKET_SIZE   64
+#endif
+
+#define DAP_SUPPORT_JTAG_SEQUENCE
+#define DAP_SUPPORT_ATTACH
+
+#ifdef DAP_USE_WORD_SHIFT
+#define DAP_SUPPORT_MEMORY_ACCESS
+#endif
+
+#ifdef DAP_USE_REGISTER_SHADOW
+#define DAP_SUPPORT_EVENTS
+#endif
+
+#endif /* __DM_BSP_H */
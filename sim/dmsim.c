@@ -0,0 +1,1172 @@
+/*
+    Dapper Miser: host test and benchmark driver for dm.c
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "dm.h"
+#include "swd_target.h"
+
+/*
+each test feeds CMSIS-DAP commands to dap_handler(), exactly as a USB transport would, and checks
+the responses and/or the state of the simulated target; "bench" instead reports what each of a set of
+typical commands costs in SWD transactions, SWCLK rising edges, and GPIO macro invocations
+*/
+
+/* the response; dap_handler() is told it has DAP_PACKET_SIZE bytes, and the rest must be left alone */
+static uint8_t packet[DAP_PACKET_SIZE + 8];
+static uint8_t request[DAP_PACKET_SIZE];
+static uint16_t response_length;
+static const char *test_name;
+static int failures;
+
+/* as many words as fit in one DAP_TransferBlock command or response */
+#define BLOCK_WORDS   ( ((DAP_PACKET_SIZE - 5) / 4) < 255 ? ((DAP_PACKET_SIZE - 5) / 4) : 255 )
+
+#define COMMAND(...)  do { static const uint8_t c[] = { __VA_ARGS__ }; command(c, sizeof(c)); } while (0)
+#define EXPECT(...)   do { static const uint8_t r[] = { __VA_ARGS__ }; expect(r, sizeof(r)); } while (0)
+
+static void fail(const char *what)
+{
+	uint16_t i;
+
+	printf("FAIL %s: %s\n     response:", test_name, what);
+	for (i = 0; (i < response_length) && (i < 24); i++)
+		printf(" %02x", packet[i]);
+	printf("\n");
+	failures++;
+}
+
+/* issues one command; sim_stats then covers just this command */
+
+static void command(const uint8_t *cmd, uint16_t len)
+{
+	memset(request, 0, sizeof(request));
+	memcpy(request, cmd, len);
+	memset(packet, 0xEE, sizeof(packet));
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	response_length = dap_handler(request, len, packet, DAP_PACKET_SIZE);
+
+	if ( (response_length > DAP_PACKET_SIZE) || (0xEE != packet[DAP_PACKET_SIZE]) )
+		fail("response overran its buffer");
+
+	/* the bits of the JTAG-to-SWD select sequence are themselves a protocol error, until the line reset that follows */
+	if ( sim_stats.protocol_errors && (0x12 /* DAP_SWJ_Sequence */ != cmd[0]) && (0x83 /* ID_DAP_Vendor3 attach */ != cmd[0]) )
+		fail("SWD protocol error");
+}
+
+static void expect(const uint8_t *response, uint16_t len)
+{
+	if ( (len != response_length) || memcmp(packet, response, len) )
+		fail("unexpected response");
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)(value >> 0);
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t ram32(uint32_t addr)
+{
+	return get32(sim_ram + (addr - sim_ram_base));
+}
+
+/* a pattern that differs in every byte of every word */
+
+static uint32_t pattern(uint32_t index)
+{
+	return 0xA5000000UL ^ (index * 0x01030507UL);
+}
+
+/* DAP_Transfer of a single request with (for a write) "value" */
+
+static void transfer1(uint8_t request, uint32_t value)
+{
+	uint8_t cmd[8] = { 0x05, 0x00, 0x01, request };
+
+	put32(cmd + 4, value);
+	command(cmd, (request & 0x02) ? 4 : 8);
+}
+
+static void set_tar(uint32_t addr)
+{
+	transfer1(0x05 /* WriteAP TAR */, addr);
+	EXPECT(0x05, 0x01, 0x01);
+}
+
+/* DAP_TransferBlock writing "words" words of pattern(first...) to DRW */
+
+static void block_write(uint32_t first, uint8_t words)
+{
+	uint8_t cmd[DAP_PACKET_SIZE];
+	uint8_t i;
+
+	cmd[0] = 0x06;
+	cmd[1] = 0x00;
+	cmd[2] = words;
+	cmd[3] = 0x00;
+	cmd[4] = 0x0D; /* WriteAP DRW */
+	for (i = 0; i < words; i++)
+		put32(cmd + 5 + 4 * i, pattern(first + i));
+	command(cmd, 5 + 4 * words);
+}
+
+static void block_read(uint8_t words)
+{
+	uint8_t cmd[5] = { 0x06, 0x00, words, 0x00, 0x0F /* ReadAP DRW */ };
+
+	command(cmd, sizeof(cmd));
+}
+
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+
+/* the transactions a memory command spends reading CSW, which setup() leaves already known to the shadow */
+#ifdef DAP_USE_REGISTER_SHADOW
+#define CSW_READS     0
+#else
+#define CSW_READS     2
+#endif
+
+/* as many words as fit in one ID_DAP_Vendor0 memory block write */
+#define MEMORY_WORDS  ((DAP_PACKET_SIZE - 8) / 4)
+
+/* ID_DAP_Vendor0 writing "words" words of pattern(first...) to "addr" */
+
+static void memory_write(uint32_t addr, uint32_t first, uint16_t words)
+{
+	uint8_t cmd[DAP_PACKET_SIZE];
+	uint16_t i;
+
+	cmd[0] = 0x80;
+	cmd[1] = 0x00;
+	put32(cmd + 2, addr);
+	cmd[6] = (uint8_t)(words >> 0);
+	cmd[7] = (uint8_t)(words >> 8);
+	for (i = 0; i < words; i++)
+		put32(cmd + 8 + 4 * i, pattern(first + i));
+	command(cmd, 8 + 4 * words);
+}
+
+static void memory_read(uint32_t addr, uint16_t words)
+{
+	uint8_t cmd[8] = { 0x80, 0x01 };
+
+	put32(cmd + 2, addr);
+	cmd[6] = (uint8_t)(words >> 0);
+	cmd[7] = (uint8_t)(words >> 8);
+	command(cmd, sizeof(cmd));
+}
+
+/* ID_DAP_Vendor2 writing the "len" bytes at "data" as elements of 1 << "size" bytes */
+
+static void memory_write_sized(uint32_t addr, uint8_t size, const uint8_t *data, uint16_t len)
+{
+	uint8_t cmd[DAP_PACKET_SIZE];
+
+	cmd[0] = 0x82;
+	cmd[1] = size << 4;
+	put32(cmd + 2, addr);
+	cmd[6] = (uint8_t)((len >> size) >> 0);
+	cmd[7] = (uint8_t)((len >> size) >> 8);
+	memcpy(cmd + 8, data, len);
+	command(cmd, 8 + len);
+}
+
+static void memory_read_sized(uint32_t addr, uint8_t size, uint16_t count)
+{
+	uint8_t cmd[8] = { 0x82 };
+
+	cmd[1] = (size << 4) | 0x01;
+	put32(cmd + 2, addr);
+	cmd[6] = (uint8_t)(count >> 0);
+	cmd[7] = (uint8_t)(count >> 8);
+	command(cmd, sizeof(cmd));
+}
+
+/* ID_DAP_Vendor1 reading the "count" addresses in "addr" */
+
+static void memory_gather(const uint32_t *addr, uint8_t count)
+{
+	uint8_t cmd[DAP_PACKET_SIZE];
+	uint8_t i;
+
+	cmd[0] = 0x81;
+	cmd[1] = count;
+	for (i = 0; i < count; i++)
+		put32(cmd + 2 + 4 * i, addr[i]);
+	command(cmd, 2 + 4 * count);
+}
+
+/* ID_DAP_Vendor4 (wait) on the word at "addr" */
+
+static void memory_wait(uint32_t addr, uint32_t mask, uint32_t match, uint32_t interval, uint32_t timeout)
+{
+	uint8_t cmd[21];
+
+	cmd[0] = 0x84;
+	put32(cmd + 1, addr);
+	put32(cmd + 5, mask);
+	put32(cmd + 9, match);
+	put32(cmd + 13, interval);
+	put32(cmd + 17, timeout);
+	command(cmd, sizeof(cmd));
+}
+
+#endif
+
+/* power-on reset, DAP_Connect, then the JTAG-to-SWD sequence and a read of IDCODE */
+
+static void attach(void)
+{
+	COMMAND(0x02, 0x01);
+	EXPECT(0x02, 0x01);
+	COMMAND(0x12, 136, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x9e, 0xe7, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00);
+	EXPECT(0x12, 0x00);
+	COMMAND(0x05, 0x00, 0x01, 0x02);
+	EXPECT(0x05, 0x01, 0x01, 0x77, 0x14, 0xc1, 0x0b);
+}
+
+/* a fresh target, powered up, with SELECT 0 and CSW for 32-bit accesses with auto-increment */
+
+static void setup(const char *name)
+{
+	test_name = name;
+	memset(&sim_inject, 0, sizeof(sim_inject));
+	memset(&sim_core, 0, sizeof(sim_core));
+	sim_target_reset();
+	attach();
+
+	COMMAND(0x04, 8, 8, 0, 64, 0);
+	EXPECT(0x04, 0x00);
+	COMMAND(0x13, 0x00);
+	EXPECT(0x13, 0x00);
+	COMMAND(0x05, 0x00, 0x03, 0x08, 0, 0, 0, 0, 0x04, 0, 0, 0, 0x50, 0x01, 0x12, 0, 0, 0x23);
+	EXPECT(0x05, 0x03, 0x01);
+}
+
+static void test_info(void)
+{
+	test_name = "info";
+
+	/* the packet size reported is that of the buffer the transport hands to dap_handler() */
+	COMMAND(0x00, 0xFF);
+	EXPECT(0x00, 0x02, (uint8_t)(DAP_PACKET_SIZE >> 0), (uint8_t)(DAP_PACKET_SIZE >> 8));
+	response_length = dap_handler(request, 2, packet, 64);
+	EXPECT(0x00, 0x02, 64, 0);
+
+	COMMAND(0x00, 0xFE);
+	EXPECT(0x00, 0x01, DAP_PACKET_COUNT);
+}
+
+static void test_idcode(void)
+{
+	test_name = "idcode";
+	sim_target_reset();
+	attach();
+}
+
+static void test_powerup(void)
+{
+	setup("powerup");
+	sim_inject.pwrup_delay = 5;
+
+	/* CTRL/STAT power-up request, then poll with a value match until both ACKs are set */
+	COMMAND(0x05, 0x00, 0x03, 0x04, 0, 0, 0, 0x50, 0x20, 0, 0, 0, 0xA0, 0x16, 0, 0, 0, 0xA0);
+	EXPECT(0x05, 0x03, 0x01);
+	if (0xF0000000UL != (sim_dp_ctrlstat() & 0xF0000000UL))
+		fail("power-up ACKs not set");
+}
+
+static void test_attach(void)
+{
+	uint32_t ctrlstat;
+
+	test_name = "attach";
+	memset(&sim_inject, 0, sizeof(sim_inject));
+	sim_target_reset();
+	sim_inject.pwrup_delay = 5;
+
+	/* one command in place of DAP_Connect, DAP_SWJ_Sequence, and the DAP_Transfers of IDCODE and the power-up */
+	COMMAND(0x83, 0x00);
+	ctrlstat = sim_dp_ctrlstat();
+	if ( (response_length != 11) || (packet[1] != 7) || (packet[2] != 0x01) || (get32(packet + 3) != 0x0BC11477UL) || (get32(packet + 7) != ctrlstat) )
+		fail("attach");
+	if ( (0xF0000000UL != (ctrlstat & 0xF0000000UL)) || (2 != sim_stats.line_resets) || !sim_reset_read() )
+		fail("attach state");
+
+	/* connect-under-reset leaves RESET asserted */
+	COMMAND(0x83, 0x01);
+	if ( (packet[1] != 7) || (packet[2] != 0x01) || sim_reset_read() )
+		fail("attach under reset");
+	COMMAND(0x10, 0x80, 0x80, 0, 0, 0, 0);
+	if (!sim_reset_read())
+		fail("RESET not released");
+}
+
+static void test_block(void)
+{
+	uint32_t base = sim_ram_base + 0x100;
+	uint8_t i;
+
+	setup("block");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	set_tar(base);
+	block_write(0, BLOCK_WORDS);
+	if ( (response_length != 4) || (packet[1] != BLOCK_WORDS) || (packet[3] != 0x01) )
+		fail("block write");
+	for (i = 0; i < BLOCK_WORDS; i++)
+		if (ram32(base + 4 * i) != pattern(i))
+			fail("block write data");
+
+	set_tar(base);
+	block_read(BLOCK_WORDS);
+	if ( (response_length != 4 + 4 * BLOCK_WORDS) || (packet[1] != BLOCK_WORDS) || (packet[3] != 0x01) )
+		fail("block read");
+	for (i = 0; i < BLOCK_WORDS; i++)
+		if (get32(packet + 4 + 4 * i) != pattern(i))
+			fail("block read data");
+
+	if (sim_ap_tar() != base + 4 * BLOCK_WORDS)
+		fail("TAR after block read");
+}
+
+static void test_overrun(void)
+{
+	uint8_t words = (DAP_PACKET_SIZE - 4) / 4;
+
+	setup("overrun");
+
+	/* a request for more words than the response can hold is cut short, rather than written past its end */
+	set_tar(sim_ram_base);
+	block_read(words + 4);
+	if ( (response_length != 4 + 4 * words) || (packet[1] != words) || (packet[3] != 0x01) )
+		fail("oversized block read");
+}
+
+static void test_execute_commands(void)
+{
+	setup("execute_commands");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	/* the responses of the batched commands follow one another */
+	COMMAND(0x7F, 4,
+		0x00, 0xFE,
+		0x05, 0x00, 0x02, 0x05, 0x00, 0x01, 0x00, 0x20, 0x0D, 0x44, 0x33, 0x22, 0x11,
+		0x06, 0x00, 0x01, 0x00, 0x0D, 0x88, 0x77, 0x66, 0x55,
+		0x05, 0x00, 0x03, 0x05, 0x00, 0x01, 0x00, 0x20, 0x0F, 0x0F);
+	EXPECT(0x7F, 4,
+		0x00, 0x01, DAP_PACKET_COUNT,
+		0x05, 0x02, 0x01,
+		0x06, 0x01, 0x00, 0x01,
+		0x05, 0x03, 0x01, 0x44, 0x33, 0x22, 0x11, 0x88, 0x77, 0x66, 0x55);
+	if ( (ram32(sim_ram_base + 0x100) != 0x11223344UL) || (ram32(sim_ram_base + 0x104) != 0x55667788UL) )
+		fail("batched writes");
+
+	/* DAP_QueueCommands is answered as DAP_ExecuteCommands, and a batch stops at a command it cannot size */
+	COMMAND(0x7E, 3, 0x00, 0xFE, 0x42, 0x00, 0x00, 0xFE);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+
+	/* ... or at one that runs past the end of the request */
+	COMMAND(0x7F, 2, 0x00, 0xFE, 0x05, 0x00, 0x01, 0x05, 0x00);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+	if (sim_stats.transactions)
+		fail("truncated command executed");
+
+	/* ... including where the request ends before the bytes that give the command's length */
+	COMMAND(0x7F, 2, 0x00, 0xFE, 0x05, 0x00, 0x03, 0x02);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+	COMMAND(0x7F, 2, 0x00, 0xFE, 0x06, 0x00);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+	COMMAND(0x7F, 3, 0x00, 0xFE);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+	if (sim_stats.transactions)
+		fail("truncated command executed");
+}
+
+/* dap_request_length(), as a bulk transport asks it after each USB packet whether a command has all arrived */
+
+static void test_request_length(void)
+{
+	static const uint8_t info[] = { 0x00, 0xFE };
+	static const uint8_t batch[] = { 0x7F, 2, 0x00, 0xFE, 0x05, 0x00, 0x01, 0x05, 0x00, 0x00, 0x00, 0x20 };
+	static const uint8_t sequence[] = { 0x14, 2, 0x08, 0xFF, 0x10 };
+	static const uint8_t vendor[] = { 0xA0 };
+	uint8_t block[5 + 4 * 15] = { 0x06, 0x00, 15, 0, 0x0D };
+
+	test_name = "request_length";
+
+	if (dap_request_length(info, 2) != 2)
+		fail("whole command");
+	if ( (dap_request_length(block, 64) != 65) || (dap_request_length(block, 65) != 65) )
+		fail("command spanning two USB packets");
+	if ( (dap_request_length(block, 3) <= 3) || (dap_request_length(sequence, 4) <= 4) )
+		fail("command cut short before its length");
+
+	/* a batch is only whole once all of its commands are */
+	if (dap_request_length(batch, 4) <= 4)
+		fail("batch missing a command");
+	if (dap_request_length(batch, 10) <= 10)
+		fail("batch cut short in a command");
+	if (dap_request_length(batch, sizeof(batch)) != sizeof(batch))
+		fail("whole batch");
+
+	/* zero says that the length cannot be worked out */
+	if (dap_request_length(vendor, sizeof(vendor)) != 0)
+		fail("vendor command");
+}
+
+static void test_tar_wrap(void)
+{
+	uint32_t page = sim_ram_base + 0x400;
+
+	setup("tar_wrap");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	/* auto-increment only covers the bottom 10 bits of TAR */
+	set_tar(page + 0x3F8);
+	block_write(0, 4);
+	EXPECT(0x06, 0x04, 0x00, 0x01);
+	if ( (ram32(page + 0x3F8) != pattern(0)) || (ram32(page + 0x3FC) != pattern(1)) ||
+		(ram32(page + 0x000) != pattern(2)) || (ram32(page + 0x004) != pattern(3)) || (ram32(page + 0x400) != 0) )
+		fail("TAR did not wrap at 1KB");
+	if (sim_ap_tar() != page + 0x008)
+		fail("TAR after wrap");
+}
+
+static void test_pipelined_reads(void)
+{
+	uint32_t base = sim_ram_base + 0x200;
+	uint8_t i;
+
+	setup("pipelined_reads");
+	for (i = 0; i < 6; i++)
+		put32(sim_ram + 0x200 + 4 * i, pattern(i));
+
+	set_tar(base);
+	COMMAND(0x05, 0x00, 0x06, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F);
+	if ( (response_length != 3 + 4 * 6) || (packet[1] != 6) || (packet[2] != 0x01) )
+		fail("DRW reads");
+	for (i = 0; i < 6; i++)
+		if (get32(packet + 3 + 4 * i) != pattern(i))
+			fail("DRW read data");
+
+	/* six posted ReadAPs collected by each other and a final RDBUFF */
+	if (7 != sim_stats.transactions)
+		fail("consecutive ReadAPs not pipelined");
+}
+
+static void test_wait(void)
+{
+	uint32_t base = sim_ram_base;
+	uint8_t i;
+
+	setup("wait");
+	for (i = 0; i < 8; i++)
+		put32(sim_ram + 4 * i, pattern(i));
+
+	/* every other AP access is refused three times, within the default of 8 retries */
+	sim_inject.wait_every = 2;
+	sim_inject.wait_count = 3;
+	set_tar(base);
+	block_read(8);
+	if ( (packet[1] != 8) || (packet[3] != 0x01) || (get32(packet + 4 + 4 * 7) != pattern(7)) )
+		fail("reads with WAIT");
+	if (0 == sim_stats.waits)
+		fail("no WAIT injected");
+
+	/* refused 20 times is too many ... */
+	sim_inject.wait_count = 20;
+	transfer1(0x0F, 0);
+	if (packet[2] != 0x02)
+		fail("WAIT not reported");
+
+	/* ... unless DAP_TransferConfigure allows for it */
+	COMMAND(0x04, 8, 100, 0, 64, 0);
+	EXPECT(0x04, 0x00);
+	set_tar(base);
+	block_read(8);
+	if ( (packet[1] != 8) || (packet[3] != 0x01) || (get32(packet + 4) != pattern(0)) )
+		fail("reads with WAIT retry of 100");
+}
+
+static void test_fault(void)
+{
+	setup("fault");
+
+	/* the second transaction of the command answers FAULT, and the third write is never attempted */
+	set_tar(sim_ram_base);
+	sim_inject.fault_at = 2;
+	COMMAND(0x05, 0x00, 0x03, 0x0D, 1, 0, 0, 0, 0x0D, 2, 0, 0, 0, 0x0D, 3, 0, 0, 0);
+	EXPECT(0x05, 0x02, 0x04);
+	if (sim_stats.ap_writes != 2)
+		fail("transfers continued after FAULT");
+}
+
+static void test_parity(void)
+{
+	setup("parity");
+
+	sim_inject.parity_at = 1;
+	COMMAND(0x05, 0x00, 0x01, 0x06 /* ReadDP CTRL/STAT */);
+	if ( (packet[1] != 1) || (packet[2] != 0x08) )
+		fail("parity error not reported");
+}
+
+static void test_sticky(void)
+{
+	setup("sticky");
+
+	/* reading off the RAM image sets STICKYERR, so the following AP access is answered with FAULT */
+	set_tar(0x30000000UL);
+	COMMAND(0x05, 0x00, 0x02, 0x0F, 0x0F);
+	if (packet[2] != 0x04)
+		fail("bus error not reported");
+	if (0 == (sim_dp_ctrlstat() & 0x20))
+		fail("STICKYERR not set");
+
+	/* dm.c ends a FAULT with a line reset, so re-attach before clearing it with DAP_WriteABORT */
+	attach();
+	COMMAND(0x08, 0x00, 0x04, 0x00, 0x00, 0x00);
+	EXPECT(0x08, 0x01);
+	if (sim_dp_ctrlstat() & 0x20)
+		fail("STICKYERR not cleared");
+}
+
+static void test_match(void)
+{
+	uint32_t i;
+
+	setup("match");
+	for (i = 0; i < 16; i++)
+		put32(sim_ram + 4 * i, i);
+
+	/* DRW reads with a value match: the sixth word is the first whose low byte is 0x05 */
+	set_tar(sim_ram_base);
+	COMMAND(0x05, 0x00, 0x02, 0x20, 0xFF, 0, 0, 0, 0x1F, 0x05, 0, 0, 0);
+	EXPECT(0x05, 0x02, 0x01);
+	if (sim_ap_tar() != sim_ram_base + 4 * 6)
+		fail("value match stopped at the wrong word");
+
+	/* no match retries at all */
+	COMMAND(0x04, 8, 8, 0, 0, 0);
+	EXPECT(0x04, 0x00);
+	COMMAND(0x05, 0x00, 0x02, 0x20, 0xFF, 0, 0, 0, 0x1F, 0x05, 0, 0, 0);
+	EXPECT(0x05, 0x02, 0x11);
+}
+
+static void test_idle(void)
+{
+	uint32_t edges;
+
+	setup("idle");
+
+	set_tar(sim_ram_base);
+	block_read(8);
+	edges = sim_stats.rising_edges;
+
+	COMMAND(0x04, 0, 8, 0, 64, 0);
+	EXPECT(0x04, 0x00);
+	set_tar(sim_ram_base);
+	block_read(8);
+	if ( (packet[1] != 8) || (packet[3] != 0x01) )
+		fail("block read with no idle cycles");
+	if (sim_stats.rising_edges + 9 * 8 != edges)
+		fail("idle cycles not dropped");
+}
+
+static void test_data_phase(void)
+{
+	setup("data_phase");
+
+	/* with ORUNDETECT, the target expects a data phase even after WAIT; it then answers FAULT until cleared */
+	COMMAND(0x13, 0x04);
+	EXPECT(0x13, 0x00);
+	transfer1(0x04 /* WriteDP CTRL/STAT */, 0x50000001UL);
+	EXPECT(0x05, 0x01, 0x01);
+	sim_inject.wait_every = 1;
+	sim_inject.wait_count = 1;
+	transfer1(0x0F, 0);
+	if (packet[2] != 0x04)
+		fail("overrun not reported");
+	if (0 == (sim_dp_ctrlstat() & 0x02))
+		fail("STICKYORUN not set");
+}
+
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+static void test_memory_block(void)
+{
+	uint32_t base = sim_ram_base + 0x3F8;
+	uint16_t i, words;
+
+	setup("memory_block");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	/* TAR is rewritten at the 1KB boundary, and only there; CSW is already as needed, so isn't */
+	memory_write(base, 0, MEMORY_WORDS);
+	if ( (response_length != 4) || (packet[1] != MEMORY_WORDS) || (packet[2] != 0) || (packet[3] != 0x01) )
+		fail("memory write");
+	for (i = 0; i < MEMORY_WORDS; i++)
+		if (ram32(base + 4 * i) != pattern(i))
+			fail("memory write data");
+	if (sim_stats.ap_writes != MEMORY_WORDS + 2)
+		fail("memory write TAR/CSW traffic");
+
+	memory_read(base, MEMORY_WORDS);
+	if ( (response_length != 4 + 4 * MEMORY_WORDS) || (packet[1] != MEMORY_WORDS) || (packet[3] != 0x01) )
+		fail("memory read");
+	for (i = 0; i < MEMORY_WORDS; i++)
+		if (get32(packet + 4 + 4 * i) != pattern(i))
+			fail("memory read data");
+
+	/* CSW is put right if the host left it otherwise */
+	transfer1(0x01 /* WriteAP CSW */, 0x23000002);
+	memory_read(base, 1);
+	if ( (packet[1] != 1) || (packet[3] != 0x01) || (get32(packet + 4) != pattern(0)) || (sim_ap_csw() != 0x23000012UL) )
+		fail("memory read with CSW rewritten");
+
+	/* a read is cut short to what the response can hold */
+	words = (DAP_PACKET_SIZE - 4) / 4;
+	memory_read(sim_ram_base, 0xFFFF);
+	if ( (response_length != 4 + 4 * words) || (packet[1] != words) || (packet[2] != 0) || (packet[3] != 0x01) )
+		fail("oversized memory read");
+
+	/* a write is cut short to the data that the request holds, with the count saying so */
+	memset(sim_ram, 0, 16);
+	COMMAND(0x80, 0x00, 0x00, 0x00, 0x00, 0x20, 0xFF, 0xFF, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99);
+	if ( (response_length != 4) || (packet[1] != 2) || (packet[2] != 0) || (packet[3] != 0x01) )
+		fail("oversized memory write");
+	if ( (ram32(sim_ram_base) != 0x44332211UL) || (ram32(sim_ram_base + 4) != 0x88776655UL) || ram32(sim_ram_base + 8) )
+		fail("oversized memory write data");
+
+	/* a batched write whose length does not fit in 16 bits is not mistaken for a short one */
+	COMMAND(0x7F, 2, 0x00, 0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x40);
+	EXPECT(0x7F, 1, 0x00, 0x01, DAP_PACKET_COUNT);
+	if (sim_stats.transactions)
+		fail("oversized batched write executed");
+
+	/* a bus error stops the command, and is reported as for DAP_TransferBlock */
+	memory_read(sim_ram_base - 4, 2);
+	if ( (packet[3] != 0x04) || (packet[1] > 1) )
+		fail("memory read fault");
+}
+
+static void test_memory_sized(void)
+{
+	static const uint8_t data[] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+	uint32_t page = sim_ram_base + 0x400;
+
+	setup("memory_sized");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	/* bytes either side of a 1KB boundary, each in its own byte lane */
+	memory_write_sized(page - 3, 0, data, 6);
+	if ( (response_length != 4) || (packet[1] != 6) || (packet[3] != 0x01) )
+		fail("byte write");
+	if ( memcmp(sim_ram + 0x400 - 3, data, 6) || sim_ram[0x400 - 4] || sim_ram[0x400 + 3] || (ram32(page) != 0x00665544UL) )
+		fail("byte write data");
+	if ( (sim_stats.ap_writes != 6 + 2 + 1) || ((sim_ap_csw() & 0x37) != 0x10) )
+		fail("byte write CSW/TAR traffic");
+
+	/* CSW is left as it is, as it is already set for bytes */
+	memory_read_sized(page - 3, 0, 6);
+	if ( (response_length != 4 + 6) || (packet[1] != 6) || (packet[3] != 0x01) || memcmp(packet + 4, data, 6) )
+		fail("byte read");
+	if (sim_stats.ap_writes != 2)
+		fail("byte read CSW/TAR traffic");
+
+	memory_write_sized(page + 0x10 + 2, 1, data, 8);
+	if ( (packet[1] != 4) || (packet[3] != 0x01) || memcmp(sim_ram + 0x410 + 2, data, 8) || sim_ram[0x410 + 1] )
+		fail("halfword write");
+	memory_read_sized(page + 0x10 + 2, 1, 4);
+	if ( (response_length != 4 + 8) || (packet[1] != 4) || (packet[3] != 0x01) || memcmp(packet + 4, data, 8) )
+		fail("halfword read");
+	if ((sim_ap_csw() & 0x37) != 0x11)
+		fail("halfword CSW");
+
+	/* a read is cut short to what the response can hold */
+	memory_read_sized(sim_ram_base, 0, 0xFFFF);
+	if ( (response_length != DAP_PACKET_SIZE) || (packet[1] != (uint8_t)(DAP_PACKET_SIZE - 4)) )
+		fail("oversized byte read");
+
+	/* there is no fourth size */
+	COMMAND(0x82, 0x31, 0, 0, 0, 0x20, 1, 0);
+	EXPECT(0x82, 0xFF);
+}
+
+static void test_memory_gather(void)
+{
+	static const uint32_t offsets[] = { 0x100, 0x7F0, 0x004, 0x100, 0x400, 0x3FC };
+	uint32_t addr[sizeof(offsets) / sizeof(offsets[0])];
+	uint8_t cmd[20];
+	uint8_t i, count = sizeof(offsets) / sizeof(offsets[0]);
+
+	setup("memory_gather");
+	for (i = 0; i < count; i++)
+	{
+		addr[i] = sim_ram_base + offsets[i];
+		put32(sim_ram + offsets[i], pattern(offsets[i]));
+	}
+
+	/* each read overlaps the TAR write of the next, so only RDBUFF is added (to the reads of CSW) */
+	memory_gather(addr, count);
+	if ( (response_length != 3 + 4 * count) || (packet[1] != count) || (packet[2] != 0x01) )
+		fail("memory gather");
+	for (i = 0; i < count; i++)
+		if (get32(packet + 3 + 4 * i) != pattern(offsets[i]))
+			fail("memory gather data");
+	if (sim_stats.transactions != 2U * count + 1 + CSW_READS)
+		fail("memory gather was not pipelined");
+
+	/* a batch that leaves exactly four bytes of the response free has no room for even one word */
+	memset(cmd, 0, sizeof(cmd));
+	cmd[0] = 0x7F;
+	cmd[1] = 4;
+	cmd[2] = 0x00;
+	cmd[3] = 0xFE;
+	cmd[4] = 0x00;
+	cmd[5] = 0xFE;
+	cmd[6] = 0x80;
+	cmd[7] = 0x01;
+	put32(cmd + 8, sim_ram_base);
+	cmd[12] = (uint8_t)((DAP_PACKET_SIZE - 16) / 4);
+	cmd[14] = 0x81;
+	cmd[15] = 1;
+	put32(cmd + 16, addr[0]);
+	command(cmd, 20);
+	if ( (response_length != DAP_PACKET_SIZE - 1) || (packet[1] != 4) || (packet[DAP_PACKET_SIZE - 4] != 0x81) ||
+	     (packet[DAP_PACKET_SIZE - 3] != 0) || (packet[DAP_PACKET_SIZE - 2] != 0x01) )
+		fail("memory gather at the end of a batch");
+
+	/* a bus error stops the command, with only the words before it returned */
+	addr[2] = sim_ram_base - 4;
+	memory_gather(addr, count);
+	if ( (response_length != 3 + 4 * 2) || (packet[1] != 2) || (packet[2] != 0x04) )
+		fail("memory gather fault");
+}
+
+static void test_memory_wait(void)
+{
+	uint32_t addr = sim_ram_base + 0x200;
+	uint8_t cmd[31];
+
+	setup("memory_wait");
+	put32(sim_ram + 0x200, 0x12345678);
+
+	/* a word that already matches needs only the one read */
+	memory_wait(addr, 0x0000FF00, 0x00005600, 10, 1000);
+	if ( (response_length != 11) || (packet[1] != 0x00) || (packet[2] != 0x01) || (get32(packet + 7) != 0x12345678) )
+		fail("immediate match");
+	if (get32(packet + 3) > 10)
+		fail("immediate match elapsed");
+
+	/* the target sets the flag part way through */
+	sim_inject.poke_at = sim_timer() + 500;
+	sim_inject.poke_addr = addr;
+	sim_inject.poke_value = 0x80000001;
+	memory_wait(addr, 0x80000000, 0x80000000, 20, 100000);
+	if ( (response_length != 11) || (packet[1] != 0x00) || (packet[2] != 0x01) || (get32(packet + 7) != 0x80000001) )
+		fail("match after poke");
+	if ( (get32(packet + 3) < 500 - 20) || (get32(packet + 3) > 500 + 20) )
+		fail("match after poke elapsed");
+	if (ram32(addr) != 0x80000001)
+		fail("poke");
+
+	/* a batch that has not left room for the response ends before the wait, rather than have it written past the end */
+	memset(cmd, 0, sizeof(cmd));
+	cmd[0] = 0x7F;
+	cmd[1] = 2;
+	cmd[2] = 0x80;
+	cmd[3] = 0x01;
+	put32(cmd + 4, sim_ram_base);
+	cmd[8] = (uint8_t)((DAP_PACKET_SIZE - 12) / 4);
+	cmd[10] = 0x84;
+	put32(cmd + 11, addr);
+	command(cmd, sizeof(cmd));
+	if ( (response_length != DAP_PACKET_SIZE - 6) || (packet[1] != 1) )
+		fail("wait at the end of a batch");
+
+	/* the timeout is beyond the 16 bits of the simulated timer, which must wrap */
+	memory_wait(addr, 0xFFFFFFFF, 0, 1000, 100000);
+	if ( (response_length != 11) || (packet[1] != 0xFF) || (packet[2] != 0x01) || (get32(packet + 7) != 0x80000001) )
+		fail("timeout");
+	if ( (get32(packet + 3) < 100000) || (get32(packet + 3) > 100000 + 10) )
+		fail("timeout elapsed");
+	if (sim_stats.ap_reads > 100000 / 1000 + 2)
+		fail("interval not observed");
+
+	/* a bus error ends the wait, with the FAULT of the read that follows it */
+	memory_wait(sim_ram_base - 4, 0xFFFFFFFF, 1, 10, 1000);
+	if ( (response_length != 11) || (packet[1] != 0xFF) || (packet[2] != 0x04) )
+		fail("wait fault");
+}
+
+static void test_core_registers(void)
+{
+	uint8_t i, fit, count;
+
+	setup("core_registers");
+	for (i = 0; i < 128; i++)
+		sim_core.regs[i] = pattern(i);
+
+	/* R0 to R12, SP, LR, the return address, xPSR, MSP and PSP, as many as fit in the response */
+	fit = (DAP_PACKET_SIZE - 3) / 4;
+	count = (19 < fit) ? 19 : fit;
+	COMMAND(0x86, 0, 0xFF, 0xFF, 0x07, 0x00);
+	if ( (response_length != 3 + 4 * count) || (packet[1] != count) || (packet[2] != 0x01) )
+		fail("register read");
+	for (i = 0; i < count; i++)
+		if (get32(packet + 3 + 4 * i) != pattern(i))
+			fail("register read data");
+
+	/* the mask is relative to the first REGSEL, here that of S0 */
+	COMMAND(0x86, 64, 0x05, 0x00, 0x00, 0x80);
+	if ( (response_length != 3 + 4 * 3) || (packet[1] != 3) || (get32(packet + 3) != pattern(64)) ||
+	     (get32(packet + 7) != pattern(66)) || (get32(packet + 11) != pattern(95)) )
+		fail("register read from S0");
+
+	/* S_REGRDY is polled for */
+	sim_inject.regrdy_delay = 3;
+	COMMAND(0x86, 0, 0x00, 0x00, 0x01, 0x00);
+	if ( (response_length != 7) || (packet[1] != 1) || (packet[2] != 0x01) || (get32(packet + 3) != pattern(16)) )
+		fail("register read with S_REGRDY delayed");
+
+	/* but only for as long as DAP_TransferConfigure's match retry allows */
+	COMMAND(0x04, 8, 8, 0, 2, 0);
+	EXPECT(0x04, 0x00);
+	sim_inject.regrdy_delay = 5;
+	COMMAND(0x86, 0, 0x01, 0x00, 0x00, 0x00);
+	if ( (response_length != 3) || (packet[1] != 0) || (packet[2] != 0x11) )
+		fail("register read with S_REGRDY never set");
+	COMMAND(0x04, 8, 8, 0, 64, 0);
+	EXPECT(0x04, 0x00);
+	sim_inject.regrdy_delay = 0;
+
+	/* R1 and PSP written, then read back within the same DAP_ExecuteCommands */
+	COMMAND(0x7F, 2, 0x87, 0, 0x02, 0x00, 0x04, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+	                 0x86, 0, 0x02, 0x00, 0x04, 0x00);
+	EXPECT(0x7F, 2, 0x87, 2, 0x01, 0x86, 2, 0x01, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88);
+	if ( (sim_core.regs[1] != 0x44332211) || (sim_core.regs[18] != 0x88776655) || (sim_core.regs[0] != pattern(0)) )
+		fail("register write");
+
+	/* a write stops at the last value that the request holds */
+	COMMAND(0x87, 4, 0x0F, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99);
+	EXPECT(0x87, 2, 0x01);
+	if ( (sim_core.regs[4] != 0x44332211) || (sim_core.regs[5] != 0x88776655) || (sim_core.regs[6] != pattern(6)) )
+		fail("register write cut short");
+}
+#endif
+
+#ifdef DAP_USE_REGISTER_SHADOW
+static void test_register_shadow(void)
+{
+	uint32_t page = sim_ram_base + 0x400;
+
+	setup("register_shadow");
+
+	/* setup() left SELECT and CSW as these would set them */
+	COMMAND(0x05, 0x00, 0x02, 0x08, 0, 0, 0, 0, 0x01, 0x12, 0, 0, 0x23);
+	EXPECT(0x05, 0x02, 0x01);
+	if (sim_stats.transactions)
+		fail("SELECT/CSW write not elided");
+
+	set_tar(page);
+	if (1 != sim_stats.transactions)
+		fail("TAR write elided");
+	set_tar(page);
+	if (sim_stats.transactions)
+		fail("TAR write not elided");
+
+	/* TAR is followed through an auto-increment, but not past the 1KB boundary */
+	transfer1(0x0F /* ReadAP DRW */, 0);
+	set_tar(page + 4);
+	if (sim_stats.transactions)
+		fail("auto-incremented TAR write not elided");
+	set_tar(page + 0x3FC);
+	transfer1(0x0F /* ReadAP DRW */, 0);
+	set_tar(page + 0x400);
+	if ( (1 != sim_stats.transactions) || (sim_ap_tar() != page + 0x400) )
+		fail("TAR write elided across 1KB boundary");
+
+	/* a change of APSEL forgets CSW */
+	transfer1(0x08 /* WriteDP SELECT */, 0x01000000);
+	transfer1(0x08 /* WriteDP SELECT */, 0);
+	transfer1(0x01 /* WriteAP CSW */, 0x23000012);
+	if (1 != sim_stats.transactions)
+		fail("CSW write elided after APSEL change");
+
+	/* so does an ABORT */
+	COMMAND(0x08, 0x00, 0x1E, 0, 0, 0);
+	EXPECT(0x08, 0x01);
+	transfer1(0x01 /* WriteAP CSW */, 0x23000012);
+	if (1 != sim_stats.transactions)
+		fail("CSW write elided after ABORT");
+
+	/* and a line reset */
+	set_tar(page);
+	attach();
+	set_tar(page);
+	if (1 != sim_stats.transactions)
+		fail("TAR write elided after line reset");
+}
+#endif
+
+#ifdef DAP_SUPPORT_EVENTS
+static uint8_t event_report[DAP_EVENT_REPORT_SIZE];
+
+/* dap_event_poll(), as called by an idle transport, until it makes a report or "polls" calls have been made */
+
+static uint8_t event_poll(uint32_t polls)
+{
+	uint8_t length = 0;
+
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	while (polls-- && !length)
+		length = dap_event_poll(event_report);
+
+	return length;
+}
+
+static void test_events(void)
+{
+	uint32_t tar = sim_ram_base + 0x100;
+
+	setup("events");
+	sim_core.dhcsr = 0x00020000; /* S_HALT */
+	set_tar(tar);
+
+	if (event_poll(5000))
+		fail("report before the monitor was armed");
+
+	/* every millisecond, on AP 0 */
+	COMMAND(0x85, 0x00, 1, 0);
+	EXPECT(0x85, 0x00);
+
+	/* the first sample is reported, whatever it finds, and SELECT, CSW and TAR are as the host left them */
+	if ( (DAP_EVENT_REPORT_SIZE != event_poll(5000)) || (0x01 != event_report[0]) || (0x01 != event_report[1]) || (get32(event_report + 2) != 0x00030000) )
+		fail("halted");
+	if ( (sim_ap_tar() != tar) || (sim_ap_csw() != 0x23000012) )
+		fail("TAR/CSW not restored");
+
+	/* nothing has changed, and about five samples are taken in 5ms */
+	if (event_poll(5000))
+		fail("report without a change");
+	if (sim_stats.transactions > 5 * 8)
+		fail("interval not observed");
+
+	/* a reset is always reported, but only the once, as reading DHCSR clears S_RESET_ST */
+	sim_core.dhcsr = 0x02020000;
+	if ( (DAP_EVENT_REPORT_SIZE != event_poll(5000)) || (0x05 != event_report[0]) )
+		fail("reset");
+	if (event_poll(5000))
+		fail("reset reported twice");
+	sim_core.dhcsr = 0x00080000;
+	if ( (DAP_EVENT_REPORT_SIZE != event_poll(5000)) || (0x02 != event_report[0]) )
+		fail("lockup");
+
+	/* the host carries on where it left off */
+	transfer1(0x0F /* ReadAP DRW */, 0);
+	if ( (response_length != 7) || (packet[2] != 0x01) || (sim_ap_tar() != tar + 4) )
+		fail("host access after monitor");
+
+	/* nothing is sampled whilst SELECT is unknown */
+	COMMAND(0x02, 0x01);
+	EXPECT(0x02, 0x01);
+	sim_core.dhcsr = 0x00020000;
+	if ( event_poll(5000) || sim_stats.transactions )
+		fail("sample with SELECT unknown");
+	attach();
+	COMMAND(0x05, 0x00, 0x02, 0x08, 0, 0, 0, 0, 0x04, 0, 0, 0, 0x50);
+	EXPECT(0x05, 0x02, 0x01);
+	if ( (DAP_EVENT_REPORT_SIZE != event_poll(5000)) || (0x01 != event_report[0]) )
+		fail("halted after reattach");
+
+	/* nor once stopped */
+	COMMAND(0x85, 0x00, 0, 0);
+	EXPECT(0x85, 0x00);
+	sim_core.dhcsr = 0;
+	if ( event_poll(5000) || sim_stats.transactions )
+		fail("sample once stopped");
+
+	/* a failed transaction stops the monitor, which says so */
+	COMMAND(0x85, 0x00, 1, 0);
+	EXPECT(0x85, 0x00);
+	sim_inject.fault_at = 3;
+	if ( (DAP_EVENT_REPORT_SIZE != event_poll(5000)) || (0x80 != event_report[0]) || (0x04 != event_report[1]) )
+		fail("stopped");
+	if (event_poll(5000))
+		fail("report once stopped");
+}
+#endif
+
+#ifdef DAP_USE_POSTED_WRITES
+static void test_posted_writes(void)
+{
+	uint32_t base = sim_ram_base + 0x800;
+	uint8_t i;
+
+	setup("posted_writes");
+	memset(sim_ram, 0, sizeof(sim_ram));
+
+	set_tar(base);
+	block_write(0, BLOCK_WORDS);
+	if ( (packet[1] != BLOCK_WORDS) || (packet[3] != 0x01) )
+		fail("posted block write");
+	if (sim_stats.ap_writes != BLOCK_WORDS)
+		fail("posted block write was not streamed");
+
+	/* a WAIT part-way through falls back to the normal path from the refused word */
+	memset(sim_ram, 0, sizeof(sim_ram));
+	sim_inject.wait_every = 7;
+	sim_inject.wait_count = 2;
+	set_tar(base);
+	block_write(0, BLOCK_WORDS);
+	if ( (packet[1] != BLOCK_WORDS) || (packet[3] != 0x01) )
+		fail("posted block write with WAIT");
+	for (i = 0; i < BLOCK_WORDS; i++)
+		if (ram32(base + 4 * i) != pattern(i))
+			fail("posted block write data with WAIT");
+	if (sim_dp_ctrlstat() & 0x03)
+		fail("ORUNDETECT/STICKYORUN left set");
+}
+#endif
+
+/* SWD cost of typical commands; each starts from a fresh target */
+
+static void report(const char *what)
+{
+	printf("%-44s %6u %8u %8u\n", what, sim_stats.transactions, sim_stats.rising_edges, sim_stats.gpio_ops);
+}
+
+static void bench(void)
+{
+	char what[64];
+
+	printf("%-44s %6s %8s %8s\n", "command", "SWD", "SWCLK", "GPIO");
+
+	setup("bench");
+	set_tar(sim_ram_base);
+	report("DAP_Transfer WriteAP TAR");
+	COMMAND(0x05, 0x00, 0x08, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F);
+	report("DAP_Transfer 8x ReadAP DRW");
+	COMMAND(0x05, 0x00, 0x04, 0x08, 0, 0, 0, 0, 0x01, 0x12, 0, 0, 0x23, 0x05, 0x00, 0x00, 0x00, 0x20, 0x0F);
+	report("DAP_Transfer SELECT, CSW, TAR, ReadAP DRW");
+
+	set_tar(sim_ram_base);
+	block_read(BLOCK_WORDS);
+	snprintf(what, sizeof(what), "DAP_TransferBlock ReadAP DRW x%u", BLOCK_WORDS);
+	report(what);
+
+	set_tar(sim_ram_base);
+	block_write(0, BLOCK_WORDS);
+	snprintf(what, sizeof(what), "DAP_TransferBlock WriteAP DRW x%u", BLOCK_WORDS);
+	report(what);
+
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	memory_read(sim_ram_base, MEMORY_WORDS);
+	snprintf(what, sizeof(what), "ID_DAP_Vendor0 memory read x%u", MEMORY_WORDS);
+	report(what);
+
+	memory_write(sim_ram_base, 0, MEMORY_WORDS);
+	snprintf(what, sizeof(what), "ID_DAP_Vendor0 memory write x%u", MEMORY_WORDS);
+	report(what);
+
+	{
+		uint32_t addr[8];
+		uint8_t i;
+
+		for (i = 0; i < 8; i++)
+			addr[i] = sim_ram_base + 0x40 * i;
+		memory_gather(addr, 8);
+		report("ID_DAP_Vendor1 memory gather x8");
+
+		COMMAND(0x05, 0x00, 0x10,
+			0x05, 0x00, 0x00, 0x00, 0x20, 0x0F, 0x05, 0x40, 0x00, 0x00, 0x20, 0x0F,
+			0x05, 0x80, 0x00, 0x00, 0x20, 0x0F, 0x05, 0xC0, 0x00, 0x00, 0x20, 0x0F,
+			0x05, 0x00, 0x01, 0x00, 0x20, 0x0F, 0x05, 0x40, 0x01, 0x00, 0x20, 0x0F,
+			0x05, 0x80, 0x01, 0x00, 0x20, 0x0F, 0x05, 0xC0, 0x01, 0x00, 0x20, 0x0F);
+		report("DAP_Transfer 8x (WriteAP TAR, ReadAP DRW)");
+	}
+#endif
+
+	COMMAND(0x04, 0, 8, 0, 64, 0);
+	set_tar(sim_ram_base);
+	block_read(BLOCK_WORDS);
+	snprintf(what, sizeof(what), "DAP_TransferBlock ReadAP DRW x%u, idle 0", BLOCK_WORDS);
+	report(what);
+
+	set_tar(sim_ram_base);
+	block_write(0, BLOCK_WORDS);
+	snprintf(what, sizeof(what), "DAP_TransferBlock WriteAP DRW x%u, idle 0", BLOCK_WORDS);
+	report(what);
+}
+
+int main(int argc, char *argv[])
+{
+	if ( (argc > 1) && !strcmp(argv[1], "bench") )
+	{
+		bench();
+		return 0;
+	}
+
+	test_info();
+	test_idcode();
+	test_powerup();
+	test_attach();
+	test_block();
+	test_overrun();
+	test_execute_commands();
+	test_request_length();
+	test_tar_wrap();
+	test_pipelined_reads();
+	test_wait();
+	test_fault();
+	test_parity();
+	test_sticky();
+	test_match();
+	test_idle();
+	test_data_phase();
+#ifdef DAP_USE_REGISTER_SHADOW
+	test_register_shadow();
+#endif
+#ifdef DAP_SUPPORT_EVENTS
+	test_events();
+#endif
+#ifdef DAP_SUPPORT_MEMORY_ACCESS
+	test_memory_block();
+	test_memory_sized();
+	test_memory_gather();
+	test_memory_wait();
+	test_core_registers();
+#endif
+#ifdef DAP_USE_POSTED_WRITES
+	test_posted_writes();
+#endif
+
+	printf("%s: %s\n", argv[0], failures ? "FAILED" : "all tests passed");
+
+	return failures ? 1 : 0;
+}
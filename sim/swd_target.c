@@ -0,0 +1,598 @@
+/*
+    Dapper Miser: SWD target simulator
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <string.h>
+#include "swd_target.h"
+
+/*
+a bit-level model of an ADIv5 SW-DP with a single AHB MEM-AP in front of a RAM image
+
+the target samples SWDIO on each rising edge of SWCLK and, when it is driving the line, changes its output
+straight after that edge; an undriven line reads as 1, as it would with the usual pull-up
+*/
+
+struct sim_inject sim_inject;
+struct sim_stats sim_stats;
+struct sim_core sim_core;
+uint8_t sim_ram[SIM_RAM_SIZE];
+uint32_t sim_ram_base = 0x20000000UL;
+
+#define DP_IDCODE          0x0BC11477UL
+#define AP_IDR             0x24770011UL
+
+#define CTRLSTAT_ORUNDETECT   0x00000001UL
+#define CTRLSTAT_STICKYORUN   0x00000002UL
+#define CTRLSTAT_STICKYCMP    0x00000010UL
+#define CTRLSTAT_STICKYERR    0x00000020UL
+#define CTRLSTAT_READOK       0x00000040UL
+#define CTRLSTAT_WDATAERR     0x00000080UL
+#define CTRLSTAT_CDBGPWRUPREQ 0x10000000UL
+#define CTRLSTAT_CDBGPWRUPACK 0x20000000UL
+#define CTRLSTAT_CSYSPWRUPREQ 0x40000000UL
+#define CTRLSTAT_CSYSPWRUPACK 0x80000000UL
+#define CTRLSTAT_STICKY       (CTRLSTAT_STICKYORUN | CTRLSTAT_STICKYCMP | CTRLSTAT_STICKYERR | CTRLSTAT_WDATAERR)
+#define CTRLSTAT_WRITABLE     0x54FFFF0DUL
+
+#define DHCSR_ADDR            0xE000EDF0UL
+#define DCRSR_ADDR            0xE000EDF4UL
+#define DCRDR_ADDR            0xE000EDF8UL
+#define DHCSR_S_REGRDY        0x00010000UL
+#define DHCSR_S_RESET_ST      0x02000000UL
+#define DCRSR_REGWNR          0x00010000UL
+
+#define ACK_OK    1
+#define ACK_WAIT  2
+#define ACK_FAULT 4
+
+enum state { ST_IDLE, ST_REQUEST, ST_TURNAROUND, ST_ACK, ST_READ_DATA, ST_WRITE_TURNAROUND, ST_WRITE_DATA, ST_LOCKOUT };
+
+static int clk_level, host_data, host_drives, target_drives, target_bit, reset_level;
+static enum state state;
+static uint32_t bit_count, ones, request, ack, shift, value, data_phase;
+static uint32_t ctrlstat, select_reg, rdbuff, csw, tar, pwrup_countdown;
+static uint32_t ap_seq, wait_remaining;
+static uint32_t timer_count, regrdy_countdown;
+static int need_idcode, wait_retry;
+
+static int line_level(void)
+{
+	if (host_drives)
+		return host_data;
+	if (target_drives)
+		return target_bit;
+	return 1;
+}
+
+static uint32_t parity32(uint32_t v)
+{
+	v ^= v >> 16;
+	v ^= v >> 8;
+	v ^= v >> 4;
+	return (0x6996 >> (v & 0x0F)) & 0x01;
+}
+
+/* word access to the core's debug registers; a DCRSR write transfers between DCRDR and the register file at once, but S_REGRDY only follows after regrdy_delay reads of DHCSR */
+
+static void core_access(uint32_t addr, uint32_t *data, int write)
+{
+	uint32_t regsel;
+
+	switch (addr)
+	{
+	case DHCSR_ADDR:
+		if (write)
+			break;
+		*data = sim_core.dhcsr | (regrdy_countdown ? 0 : DHCSR_S_REGRDY);
+		sim_core.dhcsr &= ~DHCSR_S_RESET_ST;
+		if (regrdy_countdown)
+			regrdy_countdown--;
+		break;
+	case DCRSR_ADDR:
+		if (!write)
+		{
+			*data = 0;
+			break;
+		}
+		regsel = *data & 0x7F;
+		if (*data & DCRSR_REGWNR)
+			sim_core.regs[regsel] = sim_core.dcrdr;
+		else
+			sim_core.dcrdr = sim_core.regs[regsel];
+		regrdy_countdown = sim_inject.regrdy_delay;
+		break;
+	case DCRDR_ADDR:
+		if (write)
+			sim_core.dcrdr = *data;
+		else
+			*data = sim_core.dcrdr;
+		break;
+	}
+}
+
+/* MEM-AP data access at "addr", honouring the CSW size and byte lanes; returns 0 (and sets STICKYERR) off the RAM image */
+
+static int mem_access(uint32_t addr, uint32_t size, uint32_t *data, int write)
+{
+	uint32_t offset, bytes, lane, i;
+
+	bytes = 1UL << size;
+	addr &= ~(bytes - 1);
+
+	if ( (2 == size) && (addr >= DHCSR_ADDR) && (addr <= DCRDR_ADDR) )
+	{
+		core_access(addr, data, write);
+		return 1;
+	}
+
+	if ( (addr < sim_ram_base) || (addr - sim_ram_base + bytes > SIM_RAM_SIZE) )
+	{
+		ctrlstat |= CTRLSTAT_STICKYERR;
+		if (!write)
+			*data = 0;
+		return 0;
+	}
+
+	offset = addr - sim_ram_base;
+	lane = addr & 3;
+
+	if (write)
+	{
+		for (i = 0; i < bytes; i++)
+			sim_ram[offset + i] = (uint8_t)(*data >> (8 * (lane + i)));
+	}
+	else
+	{
+		*data = 0;
+		for (i = 0; i < bytes; i++)
+			*data |= (uint32_t)sim_ram[offset + i] << (8 * (lane + i));
+	}
+
+	return 1;
+}
+
+static void tar_increment(void)
+{
+	if (0x10 == (csw & 0x30))
+		tar = (tar & ~0x3FFUL) | ((tar + (1UL << (csw & 0x07))) & 0x3FFUL); /* wraps at the 1KB boundary */
+}
+
+static uint32_t ap_read(uint32_t addr)
+{
+	uint32_t result = 0;
+
+	if (0 != (select_reg >> 24))
+		return 0; /* only APSEL 0 exists */
+
+	switch (addr)
+	{
+	case 0x00:
+		result = csw | 0x40; /* DeviceEn */
+		break;
+	case 0x04:
+		result = tar;
+		break;
+	case 0x0C:
+		mem_access(tar, csw & 0x07, &result, 0);
+		tar_increment();
+		break;
+	case 0x10: case 0x14: case 0x18: case 0x1C:
+		mem_access((tar & ~0x0FUL) | (addr & 0x0C), 2, &result, 0);
+		break;
+	case 0xFC:
+		result = AP_IDR;
+		break;
+	}
+
+	return result;
+}
+
+static void ap_write(uint32_t addr, uint32_t data)
+{
+	if (0 != (select_reg >> 24))
+		return;
+
+	switch (addr)
+	{
+	case 0x00:
+		csw = data & ~0x40UL;
+		break;
+	case 0x04:
+		tar = data;
+		break;
+	case 0x0C:
+		mem_access(tar, csw & 0x07, &data, 1);
+		tar_increment();
+		break;
+	case 0x10: case 0x14: case 0x18: case 0x1C:
+		mem_access((tar & ~0x0FUL) | (addr & 0x0C), 2, &data, 1);
+		break;
+	}
+}
+
+static uint32_t dp_read(uint32_t a)
+{
+	switch (a)
+	{
+	case 0x0:
+		return DP_IDCODE;
+	case 0x4:
+		if (pwrup_countdown && (0 == --pwrup_countdown))
+			ctrlstat = (ctrlstat & ~(CTRLSTAT_CDBGPWRUPACK | CTRLSTAT_CSYSPWRUPACK)) | ((ctrlstat & (CTRLSTAT_CDBGPWRUPREQ | CTRLSTAT_CSYSPWRUPREQ)) << 1);
+		return ctrlstat;
+	case 0x8: /* RESEND */
+	case 0xC: /* RDBUFF */
+		return rdbuff;
+	}
+	return 0;
+}
+
+static void dp_write(uint32_t a, uint32_t data)
+{
+	switch (a)
+	{
+	case 0x0: /* ABORT */
+		if (data & 0x02)
+			ctrlstat &= ~CTRLSTAT_STICKYCMP;
+		if (data & 0x04)
+			ctrlstat &= ~CTRLSTAT_STICKYERR;
+		if (data & 0x08)
+			ctrlstat &= ~CTRLSTAT_WDATAERR;
+		if (data & 0x10)
+			ctrlstat &= ~CTRLSTAT_STICKYORUN;
+		break;
+	case 0x4:
+		ctrlstat = (ctrlstat & ~CTRLSTAT_WRITABLE) | (data & CTRLSTAT_WRITABLE);
+		if (0 == (data & (CTRLSTAT_CDBGPWRUPREQ | CTRLSTAT_CSYSPWRUPREQ)))
+			ctrlstat &= ~(CTRLSTAT_CDBGPWRUPACK | CTRLSTAT_CSYSPWRUPACK);
+		else
+			pwrup_countdown = sim_inject.pwrup_delay + 1;
+		break;
+	case 0x8:
+		select_reg = data;
+		break;
+	}
+}
+
+/* the request has just been received in full: pick the ACK, and for a read latch the data to be returned */
+
+static void decide_ack(void)
+{
+	uint32_t apndp = (request >> 1) & 1, rnw = (request >> 2) & 1, a = (request >> 1) & 0x0C;
+	int privileged;
+
+	sim_stats.transactions++;
+
+	if (apndp)
+	{
+		if (rnw) sim_stats.ap_reads++; else sim_stats.ap_writes++;
+	}
+	else
+	{
+		if (rnw) sim_stats.dp_reads++; else sim_stats.dp_writes++;
+	}
+
+	privileged = !apndp && ( (rnw && (a <= 0x4)) || (!rnw && (0x0 == a)) );
+
+	ack = ACK_OK;
+
+	if (sim_inject.fault_at && (sim_stats.transactions == sim_inject.fault_at))
+		ack = ACK_FAULT;
+	else if ( (ctrlstat & CTRLSTAT_STICKYORUN) && !privileged )
+		ack = ACK_FAULT;
+	else if ( apndp && (ctrlstat & CTRLSTAT_STICKY) )
+		ack = ACK_FAULT;
+	else if (apndp && sim_inject.wait_every)
+	{
+		if (!wait_retry && (0 == (++ap_seq % sim_inject.wait_every)))
+			wait_remaining = sim_inject.wait_count;
+		if (wait_remaining)
+		{
+			wait_remaining--;
+			ack = ACK_WAIT;
+		}
+	}
+
+	wait_retry = (ACK_WAIT == ack);
+
+	if (ACK_WAIT == ack)
+		sim_stats.waits++;
+	if (ACK_FAULT == ack)
+		sim_stats.faults++;
+
+	if ( (ACK_OK != ack) && (ctrlstat & CTRLSTAT_ORUNDETECT) )
+		ctrlstat |= CTRLSTAT_STICKYORUN;
+
+	/* with ORUNDETECT set, a data phase follows whatever the ACK */
+	data_phase = (ACK_OK == ack) || (ctrlstat & CTRLSTAT_ORUNDETECT);
+
+	if ( (ACK_OK == ack) && rnw )
+	{
+		if (apndp)
+		{
+			value = rdbuff; /* AP reads are posted */
+			rdbuff = ap_read((select_reg & 0xF0) | a);
+			ctrlstat |= CTRLSTAT_READOK;
+		}
+		else
+		{
+			value = dp_read(a);
+		}
+	}
+	else
+	{
+		value = 0;
+	}
+}
+
+static void complete_write(void)
+{
+	uint32_t apndp = (request >> 1) & 1, a = (request >> 1) & 0x0C;
+
+	if (ACK_OK != ack)
+		return;
+
+	if (parity32(shift) != (value & 1))
+	{
+		ctrlstat |= CTRLSTAT_WDATAERR;
+		return;
+	}
+
+	if (apndp)
+		ap_write((select_reg & 0xF0) | a, shift);
+	else
+		dp_write(a, shift);
+}
+
+static void rising_edge(void)
+{
+	int bit = line_level();
+
+	sim_stats.rising_edges++;
+
+	/* 50 or more ones followed by a zero is a line reset, whatever state the target was in */
+	if (bit)
+	{
+		ones++;
+	}
+	else
+	{
+		if (ones >= 50)
+		{
+			sim_stats.line_resets++;
+			state = ST_IDLE;
+			target_drives = 0;
+			need_idcode = 1;
+			ones = 0;
+			return;
+		}
+		ones = 0;
+	}
+
+	switch (state)
+	{
+	case ST_IDLE:
+		if (bit && host_drives)
+		{
+			request = 1;
+			bit_count = 1;
+			state = ST_REQUEST;
+		}
+		break;
+
+	case ST_REQUEST:
+		request |= (uint32_t)bit << bit_count;
+		if (8 == ++bit_count)
+		{
+			if ( (0 != (request & 0x40)) || (0 == (request & 0x80)) ||
+				( parity32((request >> 1) & 0x0F) != ((request >> 5) & 1) ) ||
+				( need_idcode && (0x02 != ((request >> 1) & 0x0F)) ) ) /* only READ DP IDCODE after a line reset */
+			{
+				sim_stats.protocol_errors++;
+				state = ST_LOCKOUT;
+				break;
+			}
+			need_idcode = 0;
+			decide_ack();
+			state = ST_TURNAROUND;
+		}
+		break;
+
+	case ST_TURNAROUND:
+		target_drives = 1;
+		target_bit = ack & 1;
+		bit_count = 1;
+		state = ST_ACK;
+		break;
+
+	case ST_ACK:
+		if (bit_count < 3)
+		{
+			target_bit = (ack >> bit_count) & 1;
+			bit_count++;
+			break;
+		}
+
+		if (!data_phase)
+		{
+			/* the turnaround back to the host follows; a host that skips it starts its next request instead */
+			target_drives = 0;
+			state = ST_IDLE;
+		}
+		else if (request & 0x04)
+		{
+			target_drives = (ACK_OK == ack);
+			target_bit = value & 1;
+			bit_count = 1;
+			state = ST_READ_DATA;
+		}
+		else
+		{
+			target_drives = 0;
+			state = ST_WRITE_TURNAROUND;
+		}
+		break;
+
+	case ST_WRITE_TURNAROUND:
+		state = ST_WRITE_DATA;
+		bit_count = 0;
+		shift = 0;
+		break;
+
+	case ST_READ_DATA:
+		if (bit_count < 32)
+		{
+			target_bit = (value >> bit_count) & 1;
+		}
+		else if (32 == bit_count)
+		{
+			target_bit = parity32(value);
+			if (sim_inject.parity_at && (0 == --sim_inject.parity_at))
+				target_bit ^= 1;
+		}
+		else
+		{
+			target_drives = 0;
+			state = ST_IDLE;
+		}
+		bit_count++;
+		break;
+
+	case ST_WRITE_DATA:
+		if (bit_count < 32)
+			shift |= (uint32_t)bit << bit_count;
+		else
+		{
+			value = bit; /* parity */
+			complete_write();
+			state = ST_IDLE;
+		}
+		bit_count++;
+		break;
+
+	case ST_LOCKOUT:
+		break;
+	}
+}
+
+void sim_clk(int level)
+{
+	sim_stats.gpio_ops++;
+	if (level && !clk_level)
+	{
+		clk_level = 1;
+		rising_edge();
+	}
+	clk_level = level;
+}
+
+void sim_clk_dir(int output)
+{
+	(void)output;
+	sim_stats.gpio_ops++;
+}
+
+void sim_data(int level)
+{
+	sim_stats.gpio_ops++;
+	host_data = level ? 1 : 0;
+}
+
+void sim_data_dir(int output)
+{
+	sim_stats.gpio_ops++;
+	host_drives = output;
+}
+
+int sim_data_read(void)
+{
+	sim_stats.gpio_ops++;
+	return line_level();
+}
+
+int sim_clk_read(void)
+{
+	sim_stats.gpio_ops++;
+	return clk_level;
+}
+
+void sim_reset(int level)
+{
+	sim_stats.gpio_ops++;
+	reset_level = level;
+}
+
+void sim_reset_dir(int output)
+{
+	(void)output;
+	sim_stats.gpio_ops++;
+}
+
+int sim_reset_read(void)
+{
+	sim_stats.gpio_ops++;
+	return reset_level;
+}
+
+void sim_target_reset(void)
+{
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	state = ST_IDLE;
+	target_drives = 0;
+	need_idcode = 0;
+	ones = 0;
+	ctrlstat = select_reg = rdbuff = tar = 0;
+	csw = 0x23000002; /* word, no increment */
+	pwrup_countdown = 0;
+	ap_seq = wait_remaining = 0;
+	wait_retry = 0;
+	reset_level = 1;
+	timer_count = regrdy_countdown = 0;
+}
+
+uint32_t sim_dp_ctrlstat(void)
+{
+	return ctrlstat;
+}
+
+uint32_t sim_ap_csw(void)
+{
+	return csw;
+}
+
+uint32_t sim_ap_tar(void)
+{
+	return tar;
+}
+
+uint32_t sim_timer(void)
+{
+	uint32_t offset;
+	int i;
+
+	timer_count++;
+
+	if (sim_inject.poke_at && (timer_count >= sim_inject.poke_at))
+	{
+		offset = sim_inject.poke_addr - sim_ram_base;
+		for (i = 0; i < 4; i++)
+			sim_ram[offset + i] = (uint8_t)(sim_inject.poke_value >> (8 * i));
+		sim_inject.poke_at = 0;
+	}
+
+	return timer_count & 0xFFFF;
+}
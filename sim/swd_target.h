@@ -0,0 +1,93 @@
+/*
+    Dapper Miser: SWD target simulator
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#ifndef __SWD_TARGET_H
+#define __SWD_TARGET_H
+
+#include <stdint.h>
+
+/* pin-level hooks called by the mock swdio_bsp.h */
+
+void sim_clk(int level);
+void sim_clk_dir(int output);
+void sim_data(int level);
+void sim_data_dir(int output);
+int sim_data_read(void);
+int sim_clk_read(void);
+void sim_reset(int level);
+void sim_reset_dir(int output);
+int sim_reset_read(void);
+
+/* fault injection; 0 disables each */
+
+struct sim_inject
+{
+	uint32_t wait_every;      /* every Nth AP transaction answers WAIT ... */
+	uint32_t wait_count;      /* ... this many times before it is accepted */
+	uint32_t fault_at;        /* the Nth transaction (since sim_target_reset) answers FAULT */
+	uint32_t parity_at;       /* the Nth read data phase (counting down from here) has its parity bit inverted */
+	uint32_t pwrup_delay;     /* CTRL/STAT reads before the power-up ACKs follow their REQs */
+	uint32_t poke_at;         /* when sim_timer() reaches this many microseconds ... */
+	uint32_t poke_addr;       /* ... the word at this address in the RAM image ... */
+	uint32_t poke_value;      /* ... is set to this, as if by the target's own code */
+	uint32_t regrdy_delay;    /* DHCSR reads after each DCRSR write before S_REGRDY is set */
+};
+
+/* the core's debug registers (DHCSR, DCRSR and DCRDR) at 0xE000EDF0, and the registers that DCRSR transfers */
+
+struct sim_core
+{
+	uint32_t dhcsr;           /* S_REGRDY is added by the model, and S_RESET_ST clears when DHCSR is read */
+	uint32_t dcrdr;
+	uint32_t regs[128];       /* indexed by the REGSEL of DCRSR */
+};
+
+/* counters; the test driver clears these before each command */
+
+struct sim_stats
+{
+	uint32_t rising_edges;
+	uint32_t gpio_ops;
+	uint32_t transactions;
+	uint32_t ap_reads, ap_writes, dp_reads, dp_writes;
+	uint32_t waits, faults, protocol_errors, line_resets;
+};
+
+extern struct sim_inject sim_inject;
+extern struct sim_stats sim_stats;
+extern struct sim_core sim_core;
+
+/* the MEM-AP sees a RAM image of SIM_RAM_SIZE bytes at sim_ram_base; anything else is a bus error */
+
+#ifndef SIM_RAM_SIZE
+#define SIM_RAM_SIZE  0x10000UL
+#endif
+
+extern uint8_t sim_ram[SIM_RAM_SIZE];
+extern uint32_t sim_ram_base;
+
+/* power-on reset of the target: DP, AP and statistics (but not the RAM image) */
+void sim_target_reset(void);
+uint32_t sim_dp_ctrlstat(void);
+uint32_t sim_ap_csw(void);
+uint32_t sim_ap_tar(void);
+
+/* a 16-bit microsecond timer, which advances by one each time that it is read */
+uint32_t sim_timer(void);
+
+#endif /* __SWD_TARGET_H */
@@ -0,0 +1,36 @@
+#ifndef __SWDIO_BSP_H
+#define __SWDIO_BSP_H
+
+/* the pins of the probe are wired to the simulated target in swd_target.c */
+
+#include "swd_target.h"
+
+#define CLK_LOW      { sim_clk(0); }
+#define CLK_HIGH     { sim_clk(1); }
+#define CLK_ENABLE   { sim_clk_dir(1); }
+#define CLK_HIZ      { sim_clk_dir(0); }
+
+#define DATA_LOW     { sim_data(0); }
+#define DATA_HIGH    { sim_data(1); }
+#define DATA_ENABLE  { sim_data_dir(1); }
+#define DATA_HIZ     { sim_data_dir(0); }
+
+#define RESET_LOW    { sim_reset(0); }
+#define RESET_HIGH   { sim_reset(1); }
+#define RESET_ENABLE { sim_reset_dir(1); }
+#define RESET_HIZ    { sim_reset_dir(0); }
+
+#define SWDIO_INIT   { }
+
+#define DATA_READ    sim_data_read()
+#define CLK_READ     sim_clk_read()
+#define RESET_READ   sim_reset_read()
+
+/* a 16-bit timer that ticks once a microsecond each time it is read, so that a wait wraps it */
+
+#define TIMER_INIT         { }
+#define TIMER_READ         sim_timer()
+#define TIMER_MASK         0xFFFFUL
+#define TIMER_TICKS_PER_US 1
+
+#endif /* __SWDIO_BSP_H */
@@ -6,5 +6,14 @@ adjust these to suit the application
 */
 #define NUM_OF_CDC_UARTS                    1
 #define NUM_OF_VENDORHID                    1
+#define NUM_OF_DAPBULK                      1
+
+/* the event interface is only present when dm.c has a monitor to feed it; see dm_bsp.h */
+#include "dm_bsp.h"
+#ifdef DAP_SUPPORT_EVENTS
+#define NUM_OF_DAPEVENT                     1
+#else
+#define NUM_OF_DAPEVENT                     0
+#endif
 
 #endif /* __CONFIG_H */
@@ -0,0 +1,171 @@
+/*
+    CMSIS-DAP implementation for STM32F042/STM32F072
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dapbulk.h"
+#include "dm.h"
+
+/*
+this is the CMSIS-DAP v2 (bulk) counterpart to vendorhid.c, and works the same way (including receiving into, 
+and responding from, the slots directly); the differences are that each response is sent with its actual length 
+rather than padded out to a full packet, and that a packet is DAPBULK_PACKET_SIZE rather than a single USB packet; 
+a command is received a USB packet at a time, and is whole once a short packet arrives, the slot is full, or dm.c says that 
+the command is complete (as hosts do not end one with a zero-length packet); a response that is a non-zero multiple of 
+DAPBULK_EP_SIZE but shorter than DAPBULK_PACKET_SIZE is ended with a zero-length packet, as the host is otherwise left 
+waiting for the rest
+*/
+
+#if (DAP_PACKET_COUNT & (DAP_PACKET_COUNT - 1))
+#error DAP_PACKET_COUNT must be a power of two
+#endif
+
+#define SLOT(index) ((index) & (DAP_PACKET_COUNT - 1))
+
+struct dapbulk_slot
+{
+  uint8_t request[DAPBULK_PACKET_SIZE];
+  uint8_t response[DAPBULK_PACKET_SIZE];
+  uint16_t request_length, response_length;
+};
+
+static struct
+{
+  struct dapbulk_slot slot[DAP_PACKET_COUNT];
+  volatile uint8_t rx_index, dap_index, tx_index;
+  volatile uint8_t tx_busy, tx_zlp;
+  uint8_t data_in_ep;
+  USBD_HandleTypeDef *pdev;
+} message[NUM_OF_DAPBULK];
+
+static void transmit_slot(unsigned index)
+{
+  unsigned slot = SLOT(message[index].tx_index);
+  uint16_t length = message[index].slot[slot].response_length;
+
+  message[index].tx_zlp = (length > 0) && (0 == (length % DAPBULK_EP_SIZE)) && (length < DAPBULK_PACKET_SIZE);
+
+  USBD_LL_Transmit(message[index].pdev, message[index].data_in_ep, message[index].slot[slot].response, message[index].slot[slot].response_length);
+}
+
+uint8_t *DAPBulk_RxBuffer(unsigned index)
+{
+  /* where the next command should be received, or NULL if there is no free slot for it */
+  if ((uint8_t)(message[index].rx_index - message[index].tx_index) < DAP_PACKET_COUNT)
+    return message[index].slot[SLOT(message[index].rx_index)].request;
+
+  return NULL;
+}
+
+uint8_t DAPBulk_RxComplete(unsigned index, uint32_t length, uint32_t packet_length)
+{
+  /* DO NOT BLOCK; this is called by the ISR with the "length" bytes received so far, the last USB packet being "packet_length" */
+
+  if ( (packet_length < DAPBULK_EP_SIZE) || (length >= DAPBULK_PACKET_SIZE) )
+    return 1;
+
+  return dap_request_length(message[index].slot[SLOT(message[index].rx_index)].request, length) <= length;
+}
+
+uint8_t *DAPBulk_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint32_t length, uint8_t data_in_ep)
+{
+  /* DO NOT BLOCK; it is imperative that this function returns quickly, as it is called by the ISR */
+
+  message[index].slot[SLOT(message[index].rx_index)].request_length = length;
+  message[index].data_in_ep = data_in_ep;
+  message[index].pdev = pdev;
+  message[index].rx_index++;
+
+  return DAPBulk_RxBuffer(index);
+}
+
+void DAPBulk_TxComplete(unsigned index)
+{
+  /* DO NOT BLOCK; this is called by the ISR once the host has collected a response */
+
+  if (message[index].tx_zlp)
+  {
+    message[index].tx_zlp = 0;
+    USBD_LL_Transmit(message[index].pdev, message[index].data_in_ep, NULL, 0);
+    return;
+  }
+
+  message[index].tx_index++;
+
+  if (message[index].tx_index != message[index].dap_index)
+    transmit_slot(index);
+  else
+    message[index].tx_busy = 0;
+}
+
+void DAPBulk_Reset(unsigned index)
+{
+  message[index].rx_index = message[index].dap_index = message[index].tx_index = 0;
+  message[index].tx_busy = message[index].tx_zlp = 0;
+}
+
+extern void vendor_extension(const uint8_t *RxDataBuffer, uint8_t *TxDataBuffer);
+
+/* executes a command, if there is one waiting; returns non-zero if so */
+
+unsigned DAPBulk_Service(void)
+{
+  unsigned index;
+  struct dapbulk_slot *slot;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++)
+  {
+    if (message[index].dap_index != message[index].rx_index)
+    {
+      slot = &message[index].slot[SLOT(message[index].dap_index)];
+
+      if ( (slot->request[0] >= DAP_VENDOR_EXTENSION_FIRST) && (slot->request[0] < 0xA0) )
+      {
+        /* ID_DAP_Vendor0 through ID_DAP_Vendor31, less those that dm.c implements; vendor_extension() doesn't indicate a length, so the whole packet is sent */
+        vendor_extension(slot->request, slot->response);
+        slot->response_length = DAPBULK_EP_SIZE;
+      }
+      else
+      {
+        slot->response_length = dap_handler(slot->request, slot->request_length, slot->response, DAPBULK_PACKET_SIZE);
+      }
+
+      /* mark that we've handled the message */
+      message[index].dap_index++;
+
+      /* see the equivalent in vendorhid.c */
+      if (!message[index].tx_busy)
+      {
+        message[index].tx_busy = 1;
+        transmit_slot(index);
+      }
+
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void DAPBulk_Init(void)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++)
+  {
+    DAPBulk_Reset(index);
+  }
+}
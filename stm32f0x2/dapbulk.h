@@ -0,0 +1,26 @@
+#ifndef __DAPBULK_H
+#define __DAPBULK_H
+
+#include "usbd_dapbulk.h"
+#include "dm_bsp.h"
+
+/* a CMSIS-DAP v2 packet may span several USB packets */
+#define DAPBULK_PACKET_SIZE DAP_PACKET_SIZE
+
+#if (DAPBULK_PACKET_SIZE % DAPBULK_EP_SIZE)
+#error DAP_PACKET_SIZE must be a multiple of DAPBULK_EP_SIZE
+#endif
+
+#if defined(STM32F042x6) && (DAPBULK_PACKET_SIZE > DAPBULK_EP_SIZE)
+#error a STM32F042 does not have the RAM for a DAP_PACKET_SIZE larger than DAPBULK_EP_SIZE
+#endif
+
+extern uint8_t *DAPBulk_RxBuffer(unsigned index);
+extern uint8_t DAPBulk_RxComplete(unsigned index, uint32_t length, uint32_t packet_length);
+extern uint8_t *DAPBulk_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint32_t length, uint8_t data_in_ep);
+extern void DAPBulk_TxComplete(unsigned index);
+extern void DAPBulk_Reset(unsigned index);
+extern unsigned DAPBulk_Service(void);
+extern void DAPBulk_Init(void);
+
+#endif  /* __DAPBULK_H */
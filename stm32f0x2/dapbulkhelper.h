@@ -0,0 +1,55 @@
+#ifndef __DAPBULK_HELPER_H
+#define __DAPBULK_HELPER_H
+
+#include <stdint.h>
+#include "usbhelper.h"
+
+/* macro to help generate CMSIS-DAP v2 (bulk) USB descriptors */
+
+/*
+CMSIS-DAP v2 hosts identify the interface by "CMSIS-DAP" appearing in its interface string;
+rather than add another string, the product string (which already satisfies this) is re-used
+*/
+
+#define DAPBULK_DESCRIPTOR(DAPBULK_INTF, DATAOUT_EP, DATAIN_EP) \
+    { \
+      { \
+        /*Interface Descriptor */ \
+        sizeof(struct interface_descriptor),             /* bLength: Interface Descriptor size */ \
+        USB_DESC_TYPE_INTERFACE,                         /* bDescriptorType: Interface */ \
+        DAPBULK_INTF,                                    /* bInterfaceNumber: Number of Interface */ \
+        0x00,                                            /* bAlternateSetting: Alternate setting */ \
+        0x02,                                            /* bNumEndpoints */ \
+        0xFF,                                            /* bInterfaceClass: Vendor Specific */ \
+        0x00,                                            /* bInterfaceSubClass */ \
+        0x00,                                            /* bInterfaceProtocol */ \
+        USBD_IDX_PRODUCT_STR,                            /* iInterface (string index) */ \
+      }, \
+ \
+      { \
+        sizeof(struct endpoint_descriptor),            /* bLength: Endpoint Descriptor size */ \
+        USB_DESC_TYPE_ENDPOINT,                        /* bDescriptorType: Endpoint */ \
+        DATAOUT_EP,                                    /* bEndpointAddress */ \
+        0x02,                                          /* bmAttributes: Bulk */ \
+        USB_UINT16(DAPBULK_EP_SIZE),                   /* wMaxPacketSize */ \
+        0x00,                                          /* bInterval */ \
+      }, \
+ \
+      { \
+        sizeof(struct endpoint_descriptor),            /* bLength: Endpoint Descriptor size */ \
+        USB_DESC_TYPE_ENDPOINT,                        /* bDescriptorType: Endpoint */ \
+        DATAIN_EP,                                     /* bEndpointAddress */ \
+        0x02,                                          /* bmAttributes: Bulk */ \
+        USB_UINT16(DAPBULK_EP_SIZE),                   /* wMaxPacketSize */ \
+        0x00,                                          /* bInterval */ \
+      }, \
+    },
+
+struct dapbulk_interface
+{
+  struct interface_descriptor             interface;
+  struct endpoint_descriptor              ep_out;
+  struct endpoint_descriptor              ep_in;
+};
+
+#endif /* __DAPBULK_HELPER_H */
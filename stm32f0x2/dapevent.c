@@ -0,0 +1,83 @@
+/*
+    CMSIS-DAP implementation for STM32F042/STM32F072
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "dapevent.h"
+#include "dm.h"
+
+#if (NUM_OF_DAPEVENT > 0)
+
+/*
+the event interface has nothing to receive; its reports are written by dap_event_poll() in dm.c, which samples the target,
+and which DAPEvent_Service() calls from the main loop only when neither VendorHID nor DAPBulk has a command to execute
+and the last report has been collected by the host (so that none is lost or overwritten)
+*/
+
+#if (DAP_EVENT_REPORT_SIZE > DAPEVENT_EP_SIZE)
+#error DAP_EVENT_REPORT_SIZE must fit in DAPEVENT_EP_SIZE
+#endif
+
+static struct
+{
+  uint8_t report[DAPEVENT_EP_SIZE];
+  volatile uint8_t tx_busy;
+  uint8_t data_in_ep;
+  USBD_HandleTypeDef *volatile pdev;
+} message[NUM_OF_DAPEVENT];
+
+void DAPEvent_Reset(unsigned index, USBD_HandleTypeDef *pdev, uint8_t data_in_ep)
+{
+  /* pdev is NULL whilst the device is not configured */
+  message[index].data_in_ep = data_in_ep;
+  message[index].tx_busy = 0;
+  message[index].pdev = pdev;
+}
+
+void DAPEvent_TxComplete(unsigned index)
+{
+  /* DO NOT BLOCK; this is called by the ISR once the host has collected a report */
+
+  message[index].tx_busy = 0;
+}
+
+void DAPEvent_Service(void)
+{
+  unsigned index;
+  uint8_t length;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++)
+  {
+    if (!message[index].pdev || message[index].tx_busy)
+      continue;
+
+    length = dap_event_poll(message[index].report);
+    if (length)
+    {
+      message[index].tx_busy = 1;
+      USBD_LL_Transmit(message[index].pdev, message[index].data_in_ep, message[index].report, length);
+    }
+  }
+}
+
+#else
+
+/* main.c calls this regardless; without the event interface there is nothing to service */
+void DAPEvent_Service(void)
+{
+}
+
+#endif /* NUM_OF_DAPEVENT */
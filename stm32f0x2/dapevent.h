@@ -0,0 +1,10 @@
+#ifndef __DAPEVENT_H
+#define __DAPEVENT_H
+
+#include "usbd_dapevent.h"
+
+extern void DAPEvent_Reset(unsigned index, USBD_HandleTypeDef *pdev, uint8_t data_in_ep);
+extern void DAPEvent_TxComplete(unsigned index);
+extern void DAPEvent_Service(void);
+
+#endif  /* __DAPEVENT_H */
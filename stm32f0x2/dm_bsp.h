@@ -1,11 +1,32 @@
 #ifndef __DM_BSP_H
 #define __DM_BSP_H
 
-#include "usbd_vendorhid.h" /* for HID_EP_SIZE */
+#define DAP_PACKET_COUNT  4 /* number of slots in vendorhid.c and dapbulk.c; must be a power of two */
 
-#define DAP_PACKET_COUNT  1
-#define DAP_PACKET_SIZE   HID_EP_SIZE
+/*
+CMSIS-DAP v2 (bulk) packet size; any multiple of DAPBULK_EP_SIZE up to 1024, with dapbulk.c needing 
+2 * DAP_PACKET_COUNT * DAP_PACKET_SIZE bytes of RAM for it, so only raise this on a STM32F072 (512 suits it); 
+Vendor HID packets are always HID_EP_SIZE, as each is a single interrupt transfer
+*/
+#define DAP_PACKET_SIZE   64
 
 #define DAP_SUPPORT_JTAG_SEQUENCE
+#define DAP_SUPPORT_ATTACH /* vendor attach command; see swd_attach() in dm.c */
+
+#define DAP_USE_WORD_SHIFT /* 32-bit target; see dm.c */
+
+#define DAP_SUPPORT_MEMORY_ACCESS /* vendor memory commands; see memory_block() in dm.c */
+
+/* uncomment to shift SWD with SPI1 rather than bit-banging; this needs the SPI1 wiring given in swdio_bsp.h */
+//#define DAP_USE_SPI_ENGINE
+
+/* uncomment to stream large DAP_TransferBlock writes with overrun detection; see posted_write_block() in dm.c */
+//#define DAP_USE_POSTED_WRITES
+
+/* uncomment to skip writes that would leave SELECT, CSW or TAR as they already are; see shadow_update() in dm.c */
+//#define DAP_USE_REGISTER_SHADOW
+
+/* uncomment (along with the above) for a USB interface on which halts, lockups and resets of the target are reported; see dap_event_poll() in dm.c */
+//#define DAP_SUPPORT_EVENTS
 
 #endif /* __DM_BSP_H */
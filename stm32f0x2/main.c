@@ -1,6 +1,8 @@
 #include "usbd_desc.h"
 #include "usbd_composite.h" 
 #include "vendorhid.h"
+#include "dapbulk.h"
+#include "dapevent.h"
 
 USBD_HandleTypeDef USBD_Device;
 
@@ -8,6 +10,8 @@ static void SystemClock_Config(void);
 
 int main(void)
 {
+  unsigned busy;
+
   /*
   With code compiled outside Rowley, I'm seeing the USB ISR fire between USBD_Init() and USBD_RegisterClass().
   Interrupts are enabled at reset, and ST's (mis)decision is to start enabling NVIC interrupts in USBD_Init().
@@ -28,6 +32,7 @@ int main(void)
   USBD_RegisterClass(&USBD_Device, &USBD_Composite);
 
   VendorHID_Init();
+  DAPBulk_Init();
 
   /* Start Device Process */
   USBD_Start(&USBD_Device);
@@ -37,7 +42,12 @@ int main(void)
   
   for (;;)
   {
-    VendorHID_Service();
+    busy = VendorHID_Service();
+    busy |= DAPBulk_Service();
+
+    /* the target is only sampled for events when no command is waiting to be executed */
+    if (!busy)
+      DAPEvent_Service();
   }
 }
 
@@ -1,33 +1,73 @@
 #ifndef __SWDIO_BSP_H
 #define __SWDIO_BSP_H
 
+#include "stm32f0xx_hal.h"
+#include "dm_bsp.h" /* for DAP_USE_SPI_ENGINE */
+
 /*
 this must be customized to suit the end application
 */
 
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+SPI1 (AF0) shifts the SWD request and data phases; see swdio_spi.c
+SWCLK is on SCK (PB3) and SWDIO on MOSI (PB5), with MISO (PB4) also wired to SWDIO;
+the macros below bit-bang these same pins for everything else
+*/
+
+#define SWD_GPIO  GPIOB
+#define CLK_PIN   3
+#define DATA_PIN  5
+#define MISO_PIN  4
+
+#else
+
+#define SWD_GPIO  GPIOC
 #define CLK_PIN   6
 #define DATA_PIN  7
+
+#endif
+
 #define RESET_PIN 8
 
-#define CLK_LOW      { GPIOC->BSRR = (1UL << CLK_PIN) << 16; }
-#define CLK_HIGH     { GPIOC->BSRR = (1UL << CLK_PIN) << 0; }
-#define CLK_ENABLE   { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (CLK_PIN * 2))) | (0x1 << (CLK_PIN * 2)) ); }
-#define CLK_HIZ      { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (CLK_PIN * 2))) ); }
+#define CLK_LOW      { SWD_GPIO->BSRR = (1UL << CLK_PIN) << 16; }
+#define CLK_HIGH     { SWD_GPIO->BSRR = (1UL << CLK_PIN) << 0; }
+#define CLK_ENABLE   { SWD_GPIO->MODER = ( (SWD_GPIO->MODER & ~(0x3 << (CLK_PIN * 2))) | (0x1 << (CLK_PIN * 2)) ); }
+#define CLK_HIZ      { SWD_GPIO->MODER = ( (SWD_GPIO->MODER & ~(0x3 << (CLK_PIN * 2))) ); }
 
-#define DATA_LOW     { GPIOC->BSRR = (1UL << DATA_PIN) << 16; }
-#define DATA_HIGH    { GPIOC->BSRR = (1UL << DATA_PIN) << 0; }
-#define DATA_ENABLE  { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (DATA_PIN * 2))) | (0x1 << (DATA_PIN * 2)) ); }
-#define DATA_HIZ     { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (DATA_PIN * 2))) ); }
+#define DATA_LOW     { SWD_GPIO->BSRR = (1UL << DATA_PIN) << 16; }
+#define DATA_HIGH    { SWD_GPIO->BSRR = (1UL << DATA_PIN) << 0; }
+#define DATA_ENABLE  { SWD_GPIO->MODER = ( (SWD_GPIO->MODER & ~(0x3 << (DATA_PIN * 2))) | (0x1 << (DATA_PIN * 2)) ); }
+#define DATA_HIZ     { SWD_GPIO->MODER = ( (SWD_GPIO->MODER & ~(0x3 << (DATA_PIN * 2))) ); }
 
 #define RESET_LOW    { GPIOC->BSRR = (1UL << RESET_PIN) << 16; }
 #define RESET_HIGH   { GPIOC->BSRR = (1UL << RESET_PIN) << 0; }
 #define RESET_ENABLE { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (RESET_PIN * 2))) | (0x1 << (RESET_PIN * 2)) ); }
 #define RESET_HIZ    { GPIOC->MODER = ( (GPIOC->MODER & ~(0x3 << (RESET_PIN * 2))) ); }
 
+#ifdef DAP_USE_SPI_ENGINE
+#define SWDIO_INIT  { __GPIOB_CLK_ENABLE(); __GPIOC_CLK_ENABLE(); swd_spi_init(); }
+#else
 #define SWDIO_INIT  { __GPIOC_CLK_ENABLE(); }
+#endif
 
-#define DATA_READ   (GPIOC->IDR & (1UL << DATA_PIN))
-#define CLK_READ    (GPIOC->IDR & (1UL << CLK_PIN))
+#define DATA_READ   (SWD_GPIO->IDR & (1UL << DATA_PIN))
+#define CLK_READ    (SWD_GPIO->IDR & (1UL << CLK_PIN))
 #define RESET_READ  (GPIOC->IDR & (1UL << RESET_PIN))
 
+/* the 32-bit TIM2, prescaled to count microseconds, times the vendor wait command (the HAL has SysTick) */
+
+#define TIMER_INIT         { __TIM2_CLK_ENABLE(); TIM2->PSC = (SystemCoreClock / 1000000UL) - 1; TIM2->ARR = 0xFFFFFFFFUL; TIM2->EGR = TIM_EGR_UG; TIM2->CR1 = TIM_CR1_CEN; }
+#define TIMER_READ         (TIM2->CNT)
+#define TIMER_MASK         0xFFFFFFFFUL
+#define TIMER_TICKS_PER_US 1
+
+#ifdef DAP_USE_SPI_ENGINE
+#include <stdint.h>
+
+void swd_spi_init(void);
+uint8_t swd_transaction(uint8_t request, uint32_t *data);
+#endif
+
 #endif /* __SWDIO_BSP_H */
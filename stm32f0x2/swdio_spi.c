@@ -0,0 +1,201 @@
+/*
+    CMSIS-DAP implementation for STM32F042/STM32F072
+
+    Copyright (C) 2013-2018 Peter Lawrence.
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "stm32f0xx_hal.h"
+#include "swdio_bsp.h"
+
+#ifdef DAP_USE_SPI_ENGINE
+
+/*
+SPI1 takes over from bit-banging for the parts of a SWD transaction that are a whole number of bits
+suited to a SPI frame: the 8-bit request and the 32-bit data phase (as two 16-bit frames); the turnaround,
+ACK and parity cycles in between are still bit-banged on the same pins, and dm.c adds any idle cycles
+
+SCK only belongs to SPI1 for the duration of each burst of frames; otherwise it is a GPIO output,
+so that dm.c can continue to bit-bang DAP_SWJ_Sequence etc. as before
+
+SWCLK idles low throughout (CPOL=0), same as the bit-banged code.  Host data is presented ahead of each
+rising edge (CPHA=0), which is when the target samples it.  Target data changes after each rising edge,
+so it is sampled on the falling edge instead (CPHA=1).  As SPI then clocks a rising edge before sampling,
+the last ACK bit is read without the rising edge that normally follows it; the read data phase supplies it.
+*/
+
+#ifndef SWD_SPI_BR
+#define SWD_SPI_BR    (2UL << SPI_CR1_BR_Pos) /* fPCLK/8: 6MHz SWCLK */
+#endif
+
+#define SWD_SPI_CR1   (SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | SPI_CR1_LSBFIRST | SWD_SPI_BR)
+
+#define PIN_MODE(pin, mode) { SWD_GPIO->MODER = ( (SWD_GPIO->MODER & ~(0x3UL << ((pin) * 2))) | ((mode) << ((pin) * 2)) ); }
+#define MODE_INPUT    0x0UL
+#define MODE_OUTPUT   0x1UL
+#define MODE_AF       0x2UL
+
+static inline uint32_t spi_parity(uint32_t value)
+{
+  value ^= value >> 16;
+  value ^= value >> 8;
+  value ^= value >> 4;
+  return (0x6996 >> (value & 0x0F)) & 0x01;
+}
+
+/* hand SCK (and optionally MOSI) to SPI1, configured for frames of "bits" bits */
+
+static void spi_begin(uint32_t cpha, uint32_t bits, int drive_data)
+{
+  SPI1->CR1 = SWD_SPI_CR1 | cpha;
+  SPI1->CR2 = ((bits - 1) << SPI_CR2_DS_Pos) | ((bits <= 8) ? SPI_CR2_FRXTH : 0);
+  SPI1->CR1 = SWD_SPI_CR1 | cpha | SPI_CR1_SPE;
+
+  PIN_MODE(CLK_PIN, MODE_AF);
+  if (drive_data)
+    PIN_MODE(DATA_PIN, MODE_AF);
+}
+
+static uint32_t spi_frame(uint32_t data, uint32_t bits)
+{
+  /* the data register access width determines how many frames are queued */
+  if (bits <= 8)
+    *(__IO uint8_t *)&SPI1->DR = data;
+  else
+    *(__IO uint16_t *)&SPI1->DR = data;
+
+  while (!(SPI1->SR & SPI_SR_RXNE));
+
+  if (bits <= 8)
+    return *(__IO uint8_t *)&SPI1->DR;
+  else
+    return *(__IO uint16_t *)&SPI1->DR;
+}
+
+/* wait for SPI1 to finish, then return SCK to GPIO (left low, same as SPI idle) */
+
+static void spi_end(void)
+{
+  while (SPI1->SR & SPI_SR_BSY)
+    ;
+
+  CLK_LOW;
+  CLK_ENABLE;
+
+  SPI1->CR1 = SWD_SPI_CR1;
+}
+
+static void clock_cycle(void)
+{
+  CLK_HIGH;
+  CLK_LOW;
+}
+
+void swd_spi_init(void)
+{
+  __SPI1_CLK_ENABLE();
+
+  /* AF0 is SPI1 on all three pins */
+  SWD_GPIO->AFR[CLK_PIN >> 3] &= ~(0xFUL << ((CLK_PIN & 7) * 4));
+  SWD_GPIO->AFR[DATA_PIN >> 3] &= ~(0xFUL << ((DATA_PIN & 7) * 4));
+  SWD_GPIO->AFR[MISO_PIN >> 3] &= ~(0xFUL << ((MISO_PIN & 7) * 4));
+
+  SWD_GPIO->OSPEEDR |= (0x3UL << (CLK_PIN * 2)) | (0x3UL << (DATA_PIN * 2));
+
+  /* MISO is only ever an input, so it can stay with SPI1 permanently */
+  PIN_MODE(MISO_PIN, MODE_AF);
+
+  SPI1->CR1 = SWD_SPI_CR1;
+}
+
+uint8_t swd_transaction(uint8_t request, uint32_t *data)
+{
+  uint32_t ack, value;
+
+  /* request */
+  spi_begin(0, 8, 1);
+  spi_frame(request, 8);
+  spi_end();
+
+  /* turnaround, then ACK; the final rising edge is deferred (see above) */
+  DATA_HIZ;
+  ack = 0;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x01;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x02;
+  clock_cycle();
+  asm("nop");
+  if (DATA_READ)
+    ack |= 0x04;
+
+  if ( (1 /* OK */ == ack) && (request & 0x04) )
+  {
+    /* read: the first SPI rising edge is the one deferred above */
+    spi_begin(SPI_CR1_CPHA, 16, 0);
+    value = spi_frame(0xFFFF, 16);
+    value |= spi_frame(0xFFFF, 16) << 16;
+    spi_end();
+    *data = value;
+
+    /* parity bit, then turnaround */
+    CLK_HIGH;
+    CLK_LOW;
+    asm("nop");
+    if ( (DATA_READ ? 1 : 0) != spi_parity(value) )
+      ack |= 0x08;
+    clock_cycle();
+    clock_cycle();
+  }
+  else
+  {
+    clock_cycle(); /* rising edge deferred from the ACK */
+
+    if (2 /* WAIT */ == ack)
+      clock_cycle(); /* turnaround cycle (Figure 2-4 DDI 0316D) */
+
+    if (1 /* OK */ != ack)
+      return ack;
+
+    /* write: turnaround cycle, data, then parity bit */
+    clock_cycle();
+    value = *data;
+    spi_begin(0, 16, 1);
+    spi_frame(value & 0xFFFF, 16);
+    spi_frame(value >> 16, 16);
+    spi_end();
+    if (spi_parity(value))
+    {
+      DATA_HIGH;
+    }
+    else
+    {
+      DATA_LOW;
+    }
+    DATA_ENABLE;
+    clock_cycle();
+  }
+
+  /* return SWDIO to the GPIO output that shift_bits_out() expects */
+  DATA_LOW;
+  DATA_ENABLE;
+
+  return ack;
+}
+
+#endif /* DAP_USE_SPI_ENGINE */
@@ -26,6 +26,8 @@
 #include "usbd_desc.h" /* for USBD_CfgFSDesc_len and USBD_CfgFSDesc_pnt */
 #include "usbd_cdc.h"
 #include "usbd_vendorhid.h"
+#include "usbd_dapbulk.h"
+#include "usbd_dapevent.h"
 #include "config.h"
 
 /* USB handle declared in main.c */
@@ -78,6 +80,12 @@ static const struct composite_list_struct composite_list[] =
 #if (NUM_OF_VENDORHID > 0)
   { &USBD_VendorHID },
 #endif
+#if (NUM_OF_DAPBULK > 0)
+  { &USBD_DAPBulk },
+#endif
+#if (NUM_OF_DAPEVENT > 0)
+  { &USBD_DAPEvent },
+#endif
 };
 
 static uint8_t USBD_Composite_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
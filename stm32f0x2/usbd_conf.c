@@ -290,10 +290,16 @@ USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev,
                                   uint8_t ep_type,
                                   uint16_t ep_mps)
 {
+  PCD_HandleTypeDef *hpcd = pdev->pData;
+
   HAL_PCD_EP_Open(pdev->pData,
                   ep_addr,
                   ep_mps,
                   ep_type);
+
+  /* HAL_PCD_EP_Receive() only ever sets the size of buffer 1, so both halves of a double-buffered OUT endpoint are sized here */
+  if (!(ep_addr & 0x80) && hpcd->OUT_ep[ep_addr].doublebuffer)
+    PCD_SET_EP_DBUF_CNT(hpcd->Instance, ep_addr, PCD_EP_DBUF_OUT, ep_mps);
   
   return USBD_OK;
 }
@@ -414,6 +420,30 @@ USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev,
   return (HAL_OK == outcome) ? USBD_OK : USBD_BUSY;
 }
 
+/**
+  * @brief  NAKs further packets to an OUT endpoint until USBD_LL_PrepareReceive() is next called.
+  *         A double-buffered endpoint does not NAK of its own accord, and may already hold
+  *         one more packet in its other buffer; should it do so, it is put in pbuf.
+  * @param  pdev: Device handle
+  * @param  ep_addr: Endpoint Number
+  * @param  pbuf: Pointer to data to be received
+  * @retval USBD Status
+  */
+USBD_StatusTypeDef USBD_LL_PauseReceive(USBD_HandleTypeDef *pdev, 
+                                        uint8_t ep_addr,
+                                        uint8_t *pbuf)
+{
+  PCD_HandleTypeDef *hpcd = pdev->pData;
+  PCD_EPTypeDef *ep = &hpcd->OUT_ep[ep_addr & 0x7F];
+
+  PCD_SET_EP_RX_STATUS(hpcd->Instance, ep->num, USB_EP_RX_NAK);
+  ep->xfer_buff = pbuf;
+  ep->xfer_len = 0;
+  ep->xfer_count = 0;
+
+  return USBD_OK;
+}
+
 /**
   * @brief  Returns the last transfered packet size.
   * @param  pdev: Device handle
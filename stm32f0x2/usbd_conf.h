@@ -39,7 +39,7 @@
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
 /* Common Config */
-#define USBD_MAX_NUM_INTERFACES               ( (2 * NUM_OF_CDC_UARTS) + NUM_OF_VENDORHID )
+#define USBD_MAX_NUM_INTERFACES               ( (2 * NUM_OF_CDC_UARTS) + NUM_OF_VENDORHID + NUM_OF_DAPBULK + NUM_OF_DAPEVENT )
 #define USBD_MAX_NUM_CONFIGURATION            1
 #define USBD_MAX_STR_DESC_SIZ                 0x100
 #define USBD_SUPPORT_USER_STRING              0 
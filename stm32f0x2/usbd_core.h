@@ -138,6 +138,10 @@ USBD_StatusTypeDef  USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev,
                                            uint8_t  *pbuf,
                                            uint16_t  size);
 
+USBD_StatusTypeDef  USBD_LL_PauseReceive(USBD_HandleTypeDef *pdev, 
+                                         uint8_t  ep_addr,                                      
+                                         uint8_t  *pbuf);
+
 uint32_t USBD_LL_GetRxDataSize  (USBD_HandleTypeDef *pdev, uint8_t  ep_addr);  
 void  USBD_LL_Delay (uint32_t Delay);
 
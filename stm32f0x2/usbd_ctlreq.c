@@ -28,6 +28,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_ctlreq.h"
 #include "usbd_ioreq.h"
+#include "usbd_dapbulk.h"
 
 
 /** @addtogroup STM32_USBD_STATE_DEVICE_LIBRARY
@@ -120,6 +121,20 @@ USBD_StatusTypeDef  USBD_StdDevReq (USBD_HandleTypeDef *pdev , USBD_SetupReqType
 {
   USBD_StatusTypeDef ret = USBD_OK;  
   
+  /* of the non-standard requests to the device, only the MS OS 2.0 descriptor request is passed on (for DAPBulk to answer) */
+  if ((req->bmRequest & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_STANDARD)
+  {
+#if (NUM_OF_DAPBULK > 0)
+    if ( ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR) && (MSOS20_VENDOR_CODE == req->bRequest) && (MSOS20_DESCRIPTOR_INDEX == req->wIndex) )
+    {
+      pdev->pClass->Setup (pdev, req);
+      return ret;
+    }
+#endif
+    USBD_CtlError(pdev , req);
+    return ret;
+  }
+
   switch (req->bRequest) 
   {
   case USB_REQ_GET_DESCRIPTOR: 
@@ -336,6 +351,15 @@ static void USBD_GetDescriptor(USBD_HandleTypeDef *pdev ,
   case USB_DESC_TYPE_CONFIGURATION:     
     pbuf   = (uint8_t *)pdev->pClass->GetFSConfigDescriptor(&len);
     break;
+
+  case USB_DESC_TYPE_BOS:
+    if (pdev->pDesc->GetBOSDescriptor == NULL)
+    {
+      USBD_CtlError(pdev , req);
+      return;
+    }
+    pbuf = pdev->pDesc->GetBOSDescriptor(pdev->dev_speed, &len);
+    break;
     
   case USB_DESC_TYPE_STRING:
     switch ((uint8_t)(req->wValue))
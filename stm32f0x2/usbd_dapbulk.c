@@ -0,0 +1,274 @@
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbd_dapbulk.h"
+#include "usbd_desc.h"
+#include "usbd_ctlreq.h"
+#include "dapbulk.h"
+
+static uint8_t  USBD_DAPBulk_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_DAPBulk_DeInit (USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_DAPBulk_Setup (USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t  USBD_DAPBulk_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t  USBD_DAPBulk_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void     USBD_DAPBulk_PMAConfig(PCD_HandleTypeDef *hpcd, uint32_t *pma_address);
+
+const USBD_CompClassTypeDef USBD_DAPBulk = 
+{
+  .Init                  = USBD_DAPBulk_Init,
+  .DeInit                = USBD_DAPBulk_DeInit,
+  .Setup                 = USBD_DAPBulk_Setup,
+  .EP0_TxSent            = NULL,
+  .EP0_RxReady           = NULL,
+  .DataIn                = USBD_DAPBulk_DataIn,
+  .DataOut               = USBD_DAPBulk_DataOut,
+  .SOF                   = NULL,
+  .PMAConfig             = USBD_DAPBulk_PMAConfig,
+};
+
+/*
+Windows only binds WinUSB to the bulk interface without an .inf file if it is told to do so by a MS OS 2.0 descriptor set;
+the BOS descriptor in usbd_desc.c tells the host to fetch this with a vendor request using MSOS20_VENDOR_CODE
+*/
+
+__ALIGN_BEGIN static const uint8_t DAPBulk_MSOS20Desc[MSOS20_DESCRIPTOR_SET_SIZE]  __ALIGN_END =
+{
+  0x0A, 0x00,                                     /* wLength */
+  0x00, 0x00,                                     /* wDescriptorType: MS OS 2.0 descriptor set header */
+  0x00, 0x00, 0x03, 0x06,                         /* dwWindowsVersion: Windows 8.1 */
+  0xB2, 0x00,                                     /* wTotalLength */
+  0x08, 0x00,                                     /* wLength */
+  0x01, 0x00,                                     /* wDescriptorType: configuration subset header */
+  0x00,                                           /* bConfigurationValue */
+  0x00,                                           /* bReserved */
+  0xA8, 0x00,                                     /* wTotalLength */
+  0x08, 0x00,                                     /* wLength */
+  0x02, 0x00,                                     /* wDescriptorType: function subset header */
+  DAPBULK_ITF,                                    /* bFirstInterface */
+  0x00,                                           /* bReserved */
+  0xA0, 0x00,                                     /* wSubsetLength */
+  0x14, 0x00,                                     /* wLength */
+  0x03, 0x00,                                     /* wDescriptorType: compatible ID */
+  'W', 'I', 'N', 'U', 'S', 'B', 0x00, 0x00,       /* CompatibleID */
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* SubCompatibleID */
+  0x84, 0x00,                                     /* wLength */
+  0x04, 0x00,                                     /* wDescriptorType: registry property */
+  0x07, 0x00,                                     /* wPropertyDataType: REG_MULTI_SZ */
+  0x2A, 0x00,                                     /* wPropertyNameLength */
+  /* PropertyName: "DeviceInterfaceGUIDs" */
+  'D', 0x00, 'e', 0x00, 'v', 0x00, 'i', 0x00, 'c', 0x00, 'e', 0x00, 'I', 0x00, 'n', 0x00,
+  't', 0x00, 'e', 0x00, 'r', 0x00, 'f', 0x00, 'a', 0x00, 'c', 0x00, 'e', 0x00, 'G', 0x00,
+  'U', 0x00, 'I', 0x00, 'D', 0x00, 's', 0x00, 0x00, 0x00,
+  0x50, 0x00,                                     /* wPropertyDataLength */
+  /* PropertyData: "{CDB3B5AD-293B-4663-AA36-1AAE46463776}" (the CMSIS-DAP v2 interface GUID) */
+  '{', 0x00, 'C', 0x00, 'D', 0x00, 'B', 0x00, '3', 0x00, 'B', 0x00, '5', 0x00, 'A', 0x00,
+  'D', 0x00, '-', 0x00, '2', 0x00, '9', 0x00, '3', 0x00, 'B', 0x00, '-', 0x00, '4', 0x00,
+  '6', 0x00, '6', 0x00, '3', 0x00, '-', 0x00, 'A', 0x00, 'A', 0x00, '3', 0x00, '6', 0x00,
+  '-', 0x00, '1', 0x00, 'A', 0x00, 'A', 0x00, 'E', 0x00, '4', 0x00, '6', 0x00, '4', 0x00,
+  '6', 0x00, '3', 0x00, '7', 0x00, '7', 0x00, '6', 0x00, '}', 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+/* endpoint numbers and interface number for each DAPBulk instance */
+static const struct
+{
+  uint8_t data_in_ep, data_out_ep, itf_num;
+} parameters[NUM_OF_DAPBULK] = 
+{
+#if (NUM_OF_DAPBULK > 0)
+  {
+    .data_in_ep = 0x86,
+    .data_out_ep = 0x06,
+    .itf_num = DAPBULK_ITF,
+  },
+#endif
+};
+
+static USBD_DAPBulk_HandleTypeDef context[NUM_OF_DAPBULK];
+
+static uint8_t  USBD_DAPBulk_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  USBD_DAPBulk_HandleTypeDef *hbulk = context;
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++,hbulk++)
+  {
+    /* Open bulk EPs */
+    USBD_LL_OpenEP(pdev, parameters[index].data_in_ep, USBD_EP_TYPE_BULK, DAPBULK_EP_SIZE);  
+    USBD_LL_OpenEP(pdev, parameters[index].data_out_ep, USBD_EP_TYPE_BULK, DAPBULK_EP_SIZE);  
+
+    hbulk->RxPaused = 0;
+    hbulk->RxPending = 0;
+    hbulk->RxOffset = 0;
+    DAPBulk_Reset(index);
+
+    USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, DAPBulk_RxBuffer(index), DAPBULK_EP_SIZE);
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPBulk_DeInit (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++)
+  {
+    /* Close bulk EPs */
+    USBD_LL_CloseEP(pdev, parameters[index].data_in_ep);
+    USBD_LL_CloseEP(pdev, parameters[index].data_out_ep);
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPBulk_Setup (USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  USBD_DAPBulk_HandleTypeDef *hbulk = context;
+  unsigned index;
+
+  /* the MS OS 2.0 descriptor set is requested of the device as a whole, rather than of our interface */
+  if ( ((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_DEVICE) && ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR) )
+  {
+    if ( (MSOS20_VENDOR_CODE == req->bRequest) && (MSOS20_DESCRIPTOR_INDEX == req->wIndex) )
+      USBD_CtlSendData (pdev, (uint8_t *)DAPBulk_MSOS20Desc, MIN(sizeof(DAPBulk_MSOS20Desc), req->wLength));
+    else
+      USBD_CtlError (pdev, req);
+
+    return USBD_OK;
+  }
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++,hbulk++)
+  {
+    if (parameters[index].itf_num != req->wIndex)
+      continue;
+
+    switch (req->bmRequest & USB_REQ_TYPE_MASK)
+    {
+    case USB_REQ_TYPE_STANDARD:
+      switch (req->bRequest)
+      {
+      case USB_REQ_GET_INTERFACE :
+        USBD_CtlSendData (pdev, (uint8_t *)&hbulk->AltSetting, 1);
+        break;
+
+      case USB_REQ_SET_INTERFACE :
+        hbulk->AltSetting = (uint8_t)(req->wValue);
+        break;
+      }
+    }
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPBulk_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_DAPBulk_HandleTypeDef *hbulk = context;
+  unsigned index;
+  uint8_t *buffer;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++,hbulk++)
+  {
+    if (parameters[index].data_in_ep != (epnum | 0x80))
+      continue;
+
+    /* the host has collected a response, thereby freeing up a slot */
+    DAPBulk_TxComplete(index);
+
+    /* if reception was paused for want of a free slot, it can now resume */
+    if (hbulk->RxPaused)
+    {
+      buffer = DAPBulk_RxBuffer(index);
+
+      /* a command that was already in the other half of the double buffer when we paused takes the freed slot first */
+      if (buffer && hbulk->RxPending)
+      {
+        hbulk->RxPending = 0;
+        memcpy(buffer, hbulk->buffer, hbulk->RxPendingLength);
+
+        if (DAPBulk_RxComplete(index, hbulk->RxPendingLength, hbulk->RxPendingLength))
+        {
+          buffer = DAPBulk_Callback(pdev, index, hbulk->RxPendingLength, parameters[index].data_in_ep);
+        }
+        else
+        {
+          /* that was only the first USB packet of a longer command; the rest is received after it */
+          hbulk->RxOffset = hbulk->RxPendingLength;
+          buffer += hbulk->RxOffset;
+        }
+      }
+
+      if (buffer && (USBD_OK == USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, buffer, DAPBULK_EP_SIZE)))
+        hbulk->RxPaused = 0;
+    }
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPBulk_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  USBD_DAPBulk_HandleTypeDef *hbulk = context;
+  unsigned index;
+  uint32_t RxLength, PacketLength;
+  uint8_t *buffer;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++,hbulk++)
+  {
+    if (parameters[index].data_out_ep != epnum)
+      continue;
+
+    /* Get the received data length; a command of up to DAPBULK_PACKET_SIZE bytes is received one USB packet at a time */
+    PacketLength = USBD_LL_GetRxDataSize (pdev, epnum);
+    RxLength = PacketLength + hbulk->RxOffset;
+
+    /* there is no slot for a command arriving after we paused; it waits in hbulk->buffer until DataIn frees one */
+    if (hbulk->RxPaused)
+    {
+      if (PacketLength)
+      {
+        hbulk->RxPending = 1;
+        hbulk->RxPendingLength = RxLength;
+      }
+      continue;
+    }
+
+    /* the rest of the command follows in the next USB packet; a zero-length packet between commands is ignored */
+    if ( (0 == RxLength) || !DAPBulk_RxComplete(index, RxLength, PacketLength) )
+    {
+      hbulk->RxOffset = RxLength;
+      USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, DAPBulk_RxBuffer(index) + RxLength, DAPBULK_EP_SIZE);
+      continue;
+    }
+    hbulk->RxOffset = 0;
+
+    /*
+    see the equivalent in usbd_vendorhid.c; the OUT endpoint is double-buffered, so the host can already be sending the
+    next command while this one is still waiting in its slot, and isn't NAKed unless we explicitly pause
+    */
+    buffer = DAPBulk_Callback(pdev, index, RxLength, parameters[index].data_in_ep);
+    if (buffer)
+    {
+      if (USBD_OK == USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, buffer, DAPBULK_EP_SIZE))
+        continue;
+    }
+
+    USBD_LL_PauseReceive(pdev, parameters[index].data_out_ep, hbulk->buffer);
+    hbulk->RxPaused = 1;
+  }
+
+  return USBD_OK;
+}
+
+static void USBD_DAPBulk_PMAConfig(PCD_HandleTypeDef *hpcd, uint32_t *pma_address)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPBULK; index++)
+  {
+    HAL_PCDEx_PMAConfig(hpcd, parameters[index].data_in_ep, PCD_SNG_BUF, *pma_address);
+    *pma_address += DAPBULK_EP_SIZE;
+    /* the OUT endpoint gets a pair of buffers, so that the next command can arrive whilst the USB ISR empties the last */
+    HAL_PCDEx_PMAConfig(hpcd, parameters[index].data_out_ep, PCD_DBL_BUF, *pma_address | ((*pma_address + DAPBULK_EP_SIZE) << 16));
+    *pma_address += 2 * DAPBULK_EP_SIZE;
+  }
+}
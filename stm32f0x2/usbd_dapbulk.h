@@ -0,0 +1,39 @@
+#ifndef __USB_DAPBULK_H
+#define __USB_DAPBULK_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_ioreq.h"
+#include "usbd_composite.h"
+#include "config.h"
+
+#define DAPBULK_EP_SIZE               0x40
+
+/* the interface follows those of VendorHID and CDC; see usbd_desc.c */
+#define DAPBULK_ITF                   (NUM_OF_VENDORHID + 2 * NUM_OF_CDC_UARTS)
+
+/* bRequest value for the vendor request that retrieves the MS OS 2.0 descriptor set */
+#define MSOS20_VENDOR_CODE            0x01
+#define MSOS20_DESCRIPTOR_INDEX       0x07
+#define MSOS20_DESCRIPTOR_SET_SIZE    0xB2
+
+typedef struct
+{
+  uint32_t             AltSetting;
+  uint32_t             RxPaused;
+  uint32_t             RxPending, RxPendingLength;
+  uint32_t             RxOffset;
+  uint8_t buffer[DAPBULK_EP_SIZE];
+}
+USBD_DAPBulk_HandleTypeDef; 
+
+extern const USBD_CompClassTypeDef USBD_DAPBulk;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USB_DAPBULK_H */
@@ -0,0 +1,192 @@
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_dapevent.h"
+#include "usbd_desc.h"
+#include "usbd_ctlreq.h"
+#include "dapevent.h"
+#include "dm.h"
+
+#if (NUM_OF_DAPEVENT > 0)
+
+static uint8_t  USBD_DAPEvent_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_DAPEvent_DeInit (USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t  USBD_DAPEvent_Setup (USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t  USBD_DAPEvent_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum);
+static void     USBD_DAPEvent_PMAConfig(PCD_HandleTypeDef *hpcd, uint32_t *pma_address);
+
+const USBD_CompClassTypeDef USBD_DAPEvent = 
+{
+  .Init                  = USBD_DAPEvent_Init,
+  .DeInit                = USBD_DAPEvent_DeInit,
+  .Setup                 = USBD_DAPEvent_Setup,
+  .EP0_TxSent            = NULL,
+  .EP0_RxReady           = NULL,
+  .DataIn                = USBD_DAPEvent_DataIn,
+  .DataOut               = NULL,
+  .SOF                   = NULL,
+  .PMAConfig             = USBD_DAPEvent_PMAConfig,
+};
+
+/* NOTE: manually ensure that the size of this report equals the value given in the descriptor in usbd_desc.c */
+
+__ALIGN_BEGIN static const uint8_t DAPEvent_ReportDesc[21]  __ALIGN_END =
+{
+  0x06, 0x00, 0xFF,  // Usage Page = 0xFF00 (Vendor Defined Page 1)
+  0x09, 0x02,        // Usage (Vendor Usage 2)
+  0xA1, 0x01,        // Collection (Application)
+  0x15, 0x00,        // Logical Minimum
+  0x26, 0xFF, 0x00,  // Logical Maximum
+  0x75, 0x08,        // Report Size: 8-bit
+  0x95, DAP_EVENT_REPORT_SIZE, // Report Count
+  0x09, 0x02,        // Usage (Vendor Usage 2)
+  0x81, 0x02,        // Input: variable
+  0xC0,              // End Collection
+}; 
+
+/* HID report, endpoint number, and interface number for each DAPEvent instance */
+static const struct
+{
+  const uint8_t *ReportDesc;
+  unsigned ReportDesc_Length;
+  uint8_t data_in_ep, itf_num;
+} parameters[NUM_OF_DAPEVENT] = 
+{
+  {
+    .ReportDesc = DAPEvent_ReportDesc,
+    .ReportDesc_Length = sizeof(DAPEvent_ReportDesc),
+    .data_in_ep = 0x87,
+    .itf_num = DAPEVENT_ITF,
+  },
+};
+
+static USBD_DAPEvent_HandleTypeDef context[NUM_OF_DAPEVENT];
+
+static uint8_t  USBD_DAPEvent_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++)
+  {
+    /* Open HID EP */
+    USBD_LL_OpenEP(pdev, parameters[index].data_in_ep, USBD_EP_TYPE_INTR, DAPEVENT_EP_SIZE);  
+
+    DAPEvent_Reset(index, pdev, parameters[index].data_in_ep);
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPEvent_DeInit (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++)
+  {
+    /* Close HID EP */
+    USBD_LL_CloseEP(pdev, parameters[index].data_in_ep);
+
+    DAPEvent_Reset(index, NULL, parameters[index].data_in_ep);
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPEvent_Setup (USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  uint16_t len = 0;
+  const uint8_t  *pbuf = NULL;
+  USBD_DAPEvent_HandleTypeDef *hhid = context;
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++,hhid++)
+  {
+    if (parameters[index].itf_num != req->wIndex)
+      continue;
+
+    switch (req->bmRequest & USB_REQ_TYPE_MASK)
+    {
+    case USB_REQ_TYPE_CLASS :  
+      switch (req->bRequest)
+      {
+      case HID_REQ_SET_PROTOCOL:
+        hhid->Protocol = (uint8_t)(req->wValue);
+        break;
+      
+      case HID_REQ_GET_PROTOCOL:
+        USBD_CtlSendData (pdev, (uint8_t *)&hhid->Protocol, 1);    
+        break;
+      
+      case HID_REQ_SET_IDLE:
+        hhid->IdleState = (uint8_t)(req->wValue >> 8);
+        break;
+      
+      case HID_REQ_GET_IDLE:
+        USBD_CtlSendData (pdev, (uint8_t *)&hhid->IdleState, 1);        
+        break;      
+      
+      default:
+        USBD_CtlError (pdev, req);
+        return USBD_FAIL; 
+      }
+      break;
+    
+    case USB_REQ_TYPE_STANDARD:
+      switch (req->bRequest)
+      {
+      case USB_REQ_GET_DESCRIPTOR: 
+        if( req->wValue >> 8 == HID_REPORT_DESC)
+        {
+          len = MIN(parameters[index].ReportDesc_Length, req->wLength);
+          pbuf = parameters[index].ReportDesc;
+        }
+        else if( req->wValue >> 8 == HID_DESCRIPTOR_TYPE)
+        {
+          len = MIN(USBD_CfgFSDAPEventHIDDesc[index].len, req->wLength);
+          pbuf = USBD_CfgFSDAPEventHIDDesc[index].pnt;
+        }
+      
+        USBD_CtlSendData (pdev, (uint8_t *)pbuf, len);
+      
+        break;
+      
+      case USB_REQ_GET_INTERFACE :
+        USBD_CtlSendData (pdev, (uint8_t *)&hhid->AltSetting, 1);
+        break;
+      
+      case USB_REQ_SET_INTERFACE :
+        hhid->AltSetting = (uint8_t)(req->wValue);
+        break;
+      }
+    }
+  }
+
+  return USBD_OK;
+}
+
+static uint8_t  USBD_DAPEvent_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++)
+  {
+    if (parameters[index].data_in_ep != (epnum | 0x80))
+      continue;
+
+    /* the host has collected a report, so the next can be sent */
+    DAPEvent_TxComplete(index);
+  }
+
+  return USBD_OK;
+}
+
+static void USBD_DAPEvent_PMAConfig(PCD_HandleTypeDef *hpcd, uint32_t *pma_address)
+{
+  unsigned index;
+
+  for (index = 0; index < NUM_OF_DAPEVENT; index++)
+  {
+    HAL_PCDEx_PMAConfig(hpcd, parameters[index].data_in_ep, PCD_SNG_BUF, *pma_address);
+    *pma_address += DAPEVENT_EP_SIZE;
+  }
+}
+
+#endif /* NUM_OF_DAPEVENT */
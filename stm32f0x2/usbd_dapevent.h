@@ -0,0 +1,33 @@
+#ifndef __USB_DAPEVENT_H
+#define __USB_DAPEVENT_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_ioreq.h"
+#include "usbd_composite.h"
+#include "usbd_vendorhid.h" /* for the HID definitions */
+#include "config.h"
+
+#define DAPEVENT_EP_SIZE              0x08
+
+/* the interface follows that of DAPBulk; see usbd_desc.c */
+#define DAPEVENT_ITF                  (NUM_OF_VENDORHID + 2 * NUM_OF_CDC_UARTS + NUM_OF_DAPBULK)
+
+typedef struct
+{
+  uint32_t             Protocol;
+  uint32_t             IdleState;
+  uint32_t             AltSetting;
+}
+USBD_DAPEvent_HandleTypeDef;
+
+extern const USBD_CompClassTypeDef USBD_DAPEvent;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USB_DAPEVENT_H */
@@ -95,6 +95,7 @@
 #define  USB_DESC_TYPE_DEVICE_QUALIFIER                    6
 #define  USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION           7
 #define  USB_DESC_TYPE_INTERFACE_ASSOCIATION               11
+#define  USB_DESC_TYPE_BOS                                 15
 
 
 #define USB_CONFIG_REMOTE_WAKEUP                           2
@@ -196,6 +197,7 @@ typedef struct
   uint8_t  *(*GetManufacturerStrDescriptor)( USBD_SpeedTypeDef speed , uint16_t *length);  
   uint8_t  *(*GetProductStrDescriptor)( USBD_SpeedTypeDef speed , uint16_t *length);  
   uint8_t  *(*GetSerialStrDescriptor)( USBD_SpeedTypeDef speed , uint16_t *length);  
+  uint8_t  *(*GetBOSDescriptor)( USBD_SpeedTypeDef speed , uint16_t *length);  
 } USBD_DescriptorsTypeDef;
 
 /* USB Device handle structure */
@@ -24,6 +24,10 @@
 #include "cdchelper.h"
 #include "usbd_vendorhid.h"
 #include "vendorhidhelper.h"
+#include "usbd_dapbulk.h"
+#include "dapbulkhelper.h"
+#include "usbd_dapevent.h"
+#include "dapeventhelper.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -42,6 +46,7 @@ static uint8_t *USBD_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *len
 static uint8_t *USBD_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 static uint8_t *USBD_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 static uint8_t *USBD_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+static uint8_t *USBD_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 static void IntToUnicode (uint32_t value, uint8_t *pbuf, uint8_t len);
 
 /* Private variables ---------------------------------------------------------*/
@@ -52,6 +57,7 @@ const USBD_DescriptorsTypeDef USBD_Desc =
   USBD_ManufacturerStrDescriptor,
   USBD_ProductStrDescriptor,
   USBD_SerialStrDescriptor,
+  USBD_BOSDescriptor,
 };
 
 /* USB Standard Device Descriptor */
@@ -59,7 +65,7 @@ static const struct device_descriptor hUSBDDeviceDesc =
 {
   sizeof(hUSBDDeviceDesc),    /* bLength */
   USB_DESC_TYPE_DEVICE,       /* bDescriptorType */
-  USB_UINT16(0x0200),         /* bcdUSB */
+  USB_UINT16(0x0210),         /* bcdUSB: 2.1 is needed for the host to ask for the BOS descriptor */
   0x00,                       /* bDeviceClass */
   0x00,                       /* bDeviceSubClass */
   0x00,                       /* bDeviceProtocol */
@@ -81,6 +87,8 @@ struct configuration_1
   struct configuration_descriptor config;
   struct vendorhid_interface vhid[NUM_OF_VENDORHID];
   struct cdc_interface cdc[NUM_OF_CDC_UARTS];
+  struct dapbulk_interface dapbulk[NUM_OF_DAPBULK];
+  struct dapevent_interface dapevent[NUM_OF_DAPEVENT];
 };
 
 /* fully initialize the bespoke struct as a const */
@@ -112,6 +120,18 @@ __ALIGN_BEGIN static const struct configuration_1 USBD_Composite_CfgFSDesc __ALI
 #if (NUM_OF_CDC_UARTS > 1)
     /* CDC2 */
     CDC_DESCRIPTOR(/* Command ITF */ 0x03, /* Data ITF */ 0x04, /* Command EP */ 0x85, /* DataOut EP */ 0x04, /* DataIn EP */ 0x84)
+#endif
+  },
+
+  {
+#if (NUM_OF_DAPBULK > 0)
+    DAPBULK_DESCRIPTOR(/* ITF */ DAPBULK_ITF, /* DataOut EP */ 0x06, /* DataIn EP */ 0x86)
+#endif
+  },
+
+  {
+#if (NUM_OF_DAPEVENT > 0)
+    DAPEVENT_DESCRIPTOR(/* ITF */ DAPEVENT_ITF, /* DataIn EP */ 0x87, /* HID report size */ 21)
 #endif
   },
 };
@@ -134,6 +154,36 @@ const struct USBD_CfgFSHIDDesc_struct USBD_CfgFSHIDDesc_array[NUM_OF_VENDORHID]
 
 const struct USBD_CfgFSHIDDesc_struct *USBD_CfgFSHIDDesc = USBD_CfgFSHIDDesc_array;
 
+const struct USBD_CfgFSHIDDesc_struct USBD_CfgFSDAPEventHIDDesc[NUM_OF_DAPEVENT] =
+{
+#if (NUM_OF_DAPEVENT > 0)
+  { (const uint8_t *)&USBD_Composite_CfgFSDesc.dapevent[0].hid_func, sizeof(USBD_Composite_CfgFSDesc.dapevent[0].hid_func) },
+#endif
+};
+
+/*
+the BOS descriptor advertises that the MS OS 2.0 descriptor set (see usbd_dapbulk.c) is available;
+this is how Windows knows to bind WinUSB to the CMSIS-DAP v2 interface
+*/
+
+__ALIGN_BEGIN static const uint8_t USBD_BOSDesc[33] __ALIGN_END =
+{
+  0x05,                                           /* bLength */
+  0x0F,                                           /* bDescriptorType: BOS */
+  0x21, 0x00,                                     /* wTotalLength */
+  0x01,                                           /* bNumDeviceCaps */
+  0x1C,                                           /* bLength */
+  0x10,                                           /* bDescriptorType: device capability */
+  0x05,                                           /* bDevCapabilityType: platform */
+  0x00,                                           /* bReserved */
+  0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C, /* PlatformCapabilityUUID: D8DD60DF-4589-4CC7-9CD2-659D9E648A9F */
+  0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F,
+  0x00, 0x00, 0x03, 0x06,                         /* dwWindowsVersion: Windows 8.1 */
+  0xB2, 0x00,                                     /* wMSOSDescriptorSetTotalLength */
+  MSOS20_VENDOR_CODE,                             /* bMS_VendorCode */
+  0x00,                                           /* bAltEnumCode */
+};
+
 /* USB Standard Device Descriptor */
 static const uint8_t USBD_LangIDDesc[USB_LEN_LANGID_STR_DESC]= 
 {
@@ -156,6 +206,18 @@ static uint8_t *USBD_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   return (uint8_t*)&hUSBDDeviceDesc;
 }
 
+/**
+  * @brief  Returns the BOS descriptor. 
+  * @param  speed: Current device speed
+  * @param  length: Pointer to data length variable
+  * @retval Pointer to descriptor buffer
+  */
+static uint8_t *USBD_BOSDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+  *length = sizeof(USBD_BOSDesc);
+  return (uint8_t*)USBD_BOSDesc;
+}
+
 /**
   * @brief  Returns the LangID string descriptor.        
   * @param  speed: Current device speed
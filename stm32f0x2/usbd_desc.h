@@ -19,5 +19,6 @@ struct USBD_CfgFSHIDDesc_struct
 };
 
 extern const struct USBD_CfgFSHIDDesc_struct *USBD_CfgFSHIDDesc;
+extern const struct USBD_CfgFSHIDDesc_struct USBD_CfgFSDAPEventHIDDesc[];
 
 #endif /* __USBD_DESC_H */
@@ -78,7 +78,10 @@ static uint8_t  USBD_VendorHID_Init (USBD_HandleTypeDef *pdev, uint8_t cfgidx)
     USBD_LL_OpenEP(pdev, parameters[index].data_in_ep, USBD_EP_TYPE_INTR, HID_EP_SIZE);  
     USBD_LL_OpenEP(pdev, parameters[index].data_out_ep, USBD_EP_TYPE_INTR, HID_EP_SIZE);  
 
-    USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, hhid->buffer, HID_EP_SIZE);
+    hhid->RxPaused = 0;
+    VendorHID_Reset(index);
+
+    USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, VendorHID_RxBuffer(index), HID_EP_SIZE);
   }
 
   return USBD_OK;
@@ -174,11 +177,23 @@ static uint8_t  USBD_VendorHID_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
   USBD_VendorHID_HandleTypeDef *hhid = context;
   unsigned index;
+  uint8_t *buffer;
 
   for (index = 0; index < NUM_OF_VENDORHID; index++,hhid++)
   {
     if (parameters[index].data_in_ep != (epnum | 0x80))
       continue;
+
+    /* the host has collected a response, thereby freeing up a slot */
+    VendorHID_TxComplete(index);
+
+    /* if reception was paused for want of a free slot, it can now resume */
+    if (hhid->RxPaused)
+    {
+      buffer = VendorHID_RxBuffer(index);
+      if (buffer && (USBD_OK == USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, buffer, HID_EP_SIZE)))
+        hhid->RxPaused = 0;
+    }
   }
 
   return USBD_OK;
@@ -189,7 +204,7 @@ static uint8_t  USBD_VendorHID_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
   USBD_VendorHID_HandleTypeDef *hhid = context;
   unsigned index;
   uint32_t RxLength;
-  static uint8_t scratchpad[HID_EP_SIZE];
+  uint8_t *buffer;
 
   for (index = 0; index < NUM_OF_VENDORHID; index++,hhid++)
   {
@@ -199,13 +214,18 @@ static uint8_t  USBD_VendorHID_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum)
     /* Get the received data length */
     RxLength = USBD_LL_GetRxDataSize (pdev, epnum);
 
-    /* we have to make a temporary copy of the data, as the following PrepareReceive may fail */
-    memcpy(scratchpad, hhid->buffer, HID_EP_SIZE);
-
-    if (USBD_OK != USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, hhid->buffer, HID_EP_SIZE))
-      return USBD_BUSY;
+    /*
+    the command was received straight into a slot of VendorHID's queue; VendorHID_Callback() hands back the next free slot,
+    but if its queue is now full, we hold off on accepting another command until a response is sent
+    */
+    buffer = VendorHID_Callback(pdev, index, RxLength, parameters[index].data_in_ep);
+    if (buffer)
+    {
+      if (USBD_OK == USBD_LL_PrepareReceive(pdev, parameters[index].data_out_ep, buffer, HID_EP_SIZE))
+        continue;
+    }
 
-    VendorHID_Callback(pdev, index, scratchpad, RxLength, parameters[index].data_in_ep);
+    hhid->RxPaused = 1;
   }
 
   return USBD_OK;
@@ -30,7 +30,7 @@ typedef struct
   uint32_t             Protocol;   
   uint32_t             IdleState;  
   uint32_t             AltSetting;
-  uint8_t buffer[HID_EP_SIZE];
+  uint32_t             RxPaused;
 }
 USBD_VendorHID_HandleTypeDef; 
 
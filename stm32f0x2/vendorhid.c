@@ -23,64 +23,126 @@
 /*
 since parsing and responding to VendorHID is expected to take time, 
 these routines are implemented to run primarily in the main loop rather than in the ISR context
+
+each VendorHID instance has a ring of DAP_PACKET_COUNT slots so that the host can keep several 
+commands in flight; the three free-running indices are each written by only one context:
+rx_index  - advanced by VendorHID_Callback() (ISR) when a command has been received into a slot
+dap_index - advanced by VendorHID_Service() (main loop) when a command has been executed
+tx_index  - advanced by VendorHID_TxComplete() (ISR) when a response has been collected by the host
+
+the USB stack receives each command straight into the rxbuffer of its slot, and dap_handler() builds the response
+straight into the txbuffer, so nothing is copied other than to and from the PMA
 */
 
+#if (DAP_PACKET_COUNT & (DAP_PACKET_COUNT - 1))
+#error DAP_PACKET_COUNT must be a power of two
+#endif
+
+#define SLOT(index) ((index) & (DAP_PACKET_COUNT - 1))
+
 static struct
 {
-  uint32_t length;
-  uint8_t rxbuffer[HID_EP_SIZE];
-  uint8_t txbuffer[HID_EP_SIZE];
+  struct
+  {
+    uint8_t rxbuffer[HID_EP_SIZE];
+    uint8_t txbuffer[HID_EP_SIZE];
+    uint16_t rxlength;
+  } slot[DAP_PACKET_COUNT];
+  volatile uint8_t rx_index, dap_index, tx_index;
+  volatile uint8_t tx_busy;
   uint8_t data_in_ep;
   USBD_HandleTypeDef *pdev;
 } message[NUM_OF_VENDORHID];
 
-void VendorHID_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint8_t *buffer, uint32_t length, uint8_t data_in_ep)
+static void transmit_slot(unsigned index)
+{
+  USBD_LL_Transmit(message[index].pdev, message[index].data_in_ep, message[index].slot[SLOT(message[index].tx_index)].txbuffer, HID_EP_SIZE);
+}
+
+uint8_t *VendorHID_RxBuffer(unsigned index)
+{
+  /* where the next command should be received, or NULL if there is no free slot for it */
+  if ((uint8_t)(message[index].rx_index - message[index].tx_index) < DAP_PACKET_COUNT)
+    return message[index].slot[SLOT(message[index].rx_index)].rxbuffer;
+
+  return NULL;
+}
+
+uint8_t *VendorHID_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint32_t length, uint8_t data_in_ep)
 {
   /* DO NOT BLOCK; it is imperative that this function returns quickly, as it is called by the ISR */
 
-  memcpy(message[index].rxbuffer, buffer, length);
-  message[index].length = length;
+  message[index].slot[SLOT(message[index].rx_index)].rxlength = length;
   message[index].data_in_ep = data_in_ep;
   message[index].pdev = pdev;
+  message[index].rx_index++;
+
+  return VendorHID_RxBuffer(index);
+}
+
+void VendorHID_TxComplete(unsigned index)
+{
+  /* DO NOT BLOCK; this is called by the ISR once the host has collected a response */
+
+  message[index].tx_index++;
+
+  if (message[index].tx_index != message[index].dap_index)
+    transmit_slot(index);
+  else
+    message[index].tx_busy = 0;
+}
+
+void VendorHID_Reset(unsigned index)
+{
+  message[index].rx_index = message[index].dap_index = message[index].tx_index = 0;
+  message[index].tx_busy = 0;
 }
 
 extern void vendor_extension(const uint8_t *RxDataBuffer, uint8_t *TxDataBuffer);
 extern void vendor_extension_init(void);
 
-void VendorHID_Service(void)
+/* executes a command, if there is one waiting; returns non-zero if so */
+
+unsigned VendorHID_Service(void)
 {
   unsigned index;
   uint8_t *TxDataBuffer, *RxDataBuffer;
-  uint8_t *pnt, val;
-  unsigned count;
 
   for (index = 0; index < NUM_OF_VENDORHID; index++)
   {
-    if (message[index].length)
+    if (message[index].dap_index != message[index].rx_index)
     {
-      TxDataBuffer = message[index].txbuffer;
-      RxDataBuffer = message[index].rxbuffer;
+      TxDataBuffer = message[index].slot[SLOT(message[index].dap_index)].txbuffer;
+      RxDataBuffer = message[index].slot[SLOT(message[index].dap_index)].rxbuffer;
 
-      if ( (RxDataBuffer[0] >= 0x80) && (RxDataBuffer[0] < 0xA0) )
+      if ( (RxDataBuffer[0] >= DAP_VENDOR_EXTENSION_FIRST) && (RxDataBuffer[0] < 0xA0) )
       {
-        /* ID_DAP_Vendor0 through ID_DAP_Vendor31 */
+        /* ID_DAP_Vendor0 through ID_DAP_Vendor31, less those that dm.c implements */
         vendor_extension(RxDataBuffer, TxDataBuffer);
       }
       else
       {
-        dap_handler(RxDataBuffer);
-        memcpy(TxDataBuffer, RxDataBuffer, HID_EP_SIZE);
+        dap_handler(RxDataBuffer, message[index].slot[SLOT(message[index].dap_index)].rxlength, TxDataBuffer, HID_EP_SIZE);
       }
 
-      /* send back response */
-      USBD_LL_Transmit(message[index].pdev, message[index].data_in_ep, TxDataBuffer, HID_EP_SIZE);
-
       /* mark that we've handled the message */
-      message[index].length = 0;
+      message[index].dap_index++;
+
+      /*
+      send back response, unless VendorHID_TxComplete() is still busy sending earlier ones
+      (in which case it will pick this one up); dap_index must be advanced before tx_busy is tested
+      */
+      if (!message[index].tx_busy)
+      {
+        message[index].tx_busy = 1;
+        transmit_slot(index);
+      }
 
-      break;
+      return 1;
     }
   }
+
+  return 0;
 }
 
 void VendorHID_Init(void)
@@ -96,7 +158,7 @@ void VendorHID_Init(void)
 
   for (index = 0; index < NUM_OF_VENDORHID; index++)
   {
-    message[index].length = 0;
+    VendorHID_Reset(index);
   }
 }
 
@@ -3,8 +3,11 @@
 
 #include "usbd_vendorhid.h"
 
-extern void VendorHID_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint8_t *buffer, uint32_t length, uint8_t data_in_ep);
-extern void VendorHID_Service(void);
+extern uint8_t *VendorHID_RxBuffer(unsigned index);
+extern uint8_t *VendorHID_Callback(USBD_HandleTypeDef *pdev, unsigned index, uint32_t length, uint8_t data_in_ep);
+extern void VendorHID_TxComplete(unsigned index);
+extern void VendorHID_Reset(unsigned index);
+extern unsigned VendorHID_Service(void);
 extern void VendorHID_Init(void);
 
 #endif  /* __VENDORHID_H */